@@ -0,0 +1,223 @@
+#ifndef _allocator_h
+#define _allocator_h
+
+#include <cstdlib> // malloc, free
+#include <utility> // move
+#include "utility.h"
+
+
+// allocation policies used by node based containers (Set, Stack)
+// every policy has:
+//   void* allocate(u64 size)
+//   void deallocate(void* memory, u64 size)
+//   void* allocate_bulk(u64 count, u64 size, u64 & stride) - one block for count objects placed stride bytes
+//     apart, each of them can be deallocated on its own, returns nullptr if policy can't do that
+//   void release() - frees everything allocated at once, when BULK_RELEASE is true
+// container's copy gets a new allocator, nodes of two containers are never mixed
+
+
+// every node is allocated and freed separately by malloc/free
+struct heap_allocator
+{
+	// release frees nothing, every node has to be deallocated
+	static const bool BULK_RELEASE = false;
+
+	void* allocate(u64 size)
+	{
+		void* memory = malloc(size);
+		if (memory == nullptr) ERROR("heap_allocator: failed to allocate %llu bytes", size);
+		return memory;
+	}
+
+	void deallocate(void* memory, u64) { free(memory); }
+
+	// part of a block can't be freed, objects have to be allocated one by one
+	void* allocate_bulk(u64, u64, u64 &) { return nullptr; }
+
+	void release() { /* empty */ }
+};
+
+
+// nodes are cut from big slabs, freed ones are kept in a free list per size class and reused
+// so a container which keeps inserting and removing stops calling malloc once its pool is large enough
+// release frees all slabs at once without visiting nodes
+// sizes are rounded up to ALIGNMENT, which is also the alignment of returned memory
+// sizes above MAX_POOLED get their own block, still freed by release
+class PoolAllocator
+{
+public:
+	// release frees all memory, nodes don't have to be deallocated one by one
+	static const bool BULK_RELEASE = true;
+
+private:
+	static const u64 ALIGNMENT = 16;
+	static const u64 MAX_POOLED = 256;
+	static const u64 CLASSES = MAX_POOLED / ALIGNMENT;
+	// slabs double in size, so small containers don't reserve much memory
+	static const u64 INITIAL_SLAB_SIZE = 1024;
+	static const u64 MAX_SLAB_SIZE = 64 * 1024;
+
+	// freed cell is linked into its size class' free list through its own memory
+	struct FreeCell
+	{
+		FreeCell* next;
+	};
+
+	// every slab and big block starts with a header linking it to the others
+	// big blocks are linked both ways, so one can be freed without walking the list
+	struct alignas(ALIGNMENT) Block
+	{
+		Block* prev;
+		Block* next;
+	};
+
+	FreeCell* free_lists[CLASSES];
+	Block* slabs;
+	Block* big_blocks;
+	// unused part of the newest slab, new cells of every size class are cut from it
+	char* slab_pos;
+	char* slab_end;
+	u64 slab_size; // size of the next slab
+
+	static Block* allocateBlock(u64 size)
+	{
+		Block* block = (Block*)malloc(sizeof(Block) + size);
+		if (block == nullptr) ERROR("PoolAllocator: failed to allocate %llu bytes", size);
+		return block;
+	}
+
+	void reset()
+	{
+		for (u64 i = 0; i < CLASSES; ++i) free_lists[i] = nullptr;
+		slabs = big_blocks = nullptr;
+		slab_pos = slab_end = nullptr;
+		slab_size = INITIAL_SLAB_SIZE;
+	}
+
+	// cuts a cell from the current slab, starting a new slab if it doesn't fit
+	void* cutCell(u64 cell_size)
+	{
+		if (slab_pos + cell_size > slab_end || slab_pos == nullptr)
+		{
+			// rest of the old slab is left unused
+			Block* slab = allocateBlock(slab_size);
+			slab->next = slabs;
+			slabs = slab;
+			slab_pos = (char*)(slab + 1);
+			slab_end = slab_pos + slab_size;
+			if (slab_size < MAX_SLAB_SIZE) slab_size *= 2;
+		}
+		void* cell = slab_pos;
+		slab_pos += cell_size;
+		return cell;
+	}
+
+public:
+
+	PoolAllocator() { reset(); }
+
+	// copy of a pool is a new empty pool, memory of one container is never shared with another one
+	PoolAllocator(const PoolAllocator &) { reset(); }
+
+	// move constructor
+	PoolAllocator(PoolAllocator && pool)
+	{
+		for (u64 i = 0; i < CLASSES; ++i) free_lists[i] = pool.free_lists[i];
+		slabs = pool.slabs;
+		big_blocks = pool.big_blocks;
+		slab_pos = pool.slab_pos;
+		slab_end = pool.slab_end;
+		slab_size = pool.slab_size;
+		pool.reset();
+	}
+
+	// copy/move assignment utilizing copy/move constructor by taking argument as value
+	PoolAllocator & operator=(PoolAllocator pool)
+	{
+		for (u64 i = 0; i < CLASSES; ++i) swap(free_lists[i], pool.free_lists[i]);
+		swap(slabs, pool.slabs);
+		swap(big_blocks, pool.big_blocks);
+		swap(slab_pos, pool.slab_pos);
+		swap(slab_end, pool.slab_end);
+		swap(slab_size, pool.slab_size);
+		return *this;
+	}
+
+	~PoolAllocator() { release(); }
+
+	void* allocate(u64 size)
+	{
+		if (size > MAX_POOLED)
+		{
+			Block* block = allocateBlock(size);
+			block->prev = nullptr;
+			block->next = big_blocks;
+			if (big_blocks != nullptr) big_blocks->prev = block;
+			big_blocks = block;
+			return block + 1;
+		}
+
+		const u64 size_class = size == 0 ? 0 : (size - 1) / ALIGNMENT;
+		FreeCell* cell = free_lists[size_class];
+		if (cell != nullptr)
+		{
+			free_lists[size_class] = cell->next;
+			return cell;
+		}
+		return cutCell((size_class + 1) * ALIGNMENT);
+	}
+
+	// block gets a slab of its own, cells are placed one size class apart and freed ones join its free list
+	void* allocate_bulk(u64 count, u64 size, u64 & stride)
+	{
+		if (size > MAX_POOLED || count == 0) return nullptr;
+		stride = (size == 0 ? 1 : (size - 1) / ALIGNMENT + 1) * ALIGNMENT;
+		if ((count * stride) / stride != count)
+			ERROR("PoolAllocator: bulk allocation failed, count(%llu) * size(%llu) overflows", count, stride);
+
+		Block* slab = allocateBlock(count * stride);
+		slab->next = slabs;
+		slabs = slab;
+		return slab + 1;
+	}
+
+	// size has to be the same as the one memory was allocated with
+	void deallocate(void* memory, u64 size)
+	{
+		if (size > MAX_POOLED)
+		{
+			Block* block = (Block*)memory - 1;
+			if (block->prev != nullptr) block->prev->next = block->next;
+			else big_blocks = block->next;
+			if (block->next != nullptr) block->next->prev = block->prev;
+			free(block);
+			return;
+		}
+
+		const u64 size_class = size == 0 ? 0 : (size - 1) / ALIGNMENT;
+		FreeCell* cell = (FreeCell*)memory;
+		cell->next = free_lists[size_class];
+		free_lists[size_class] = cell;
+	}
+
+	// frees all memory given out by this pool, objects living in it have to be destructed beforehand
+	void release()
+	{
+		while (slabs != nullptr)
+		{
+			Block* next = slabs->next;
+			free(slabs);
+			slabs = next;
+		}
+		while (big_blocks != nullptr)
+		{
+			Block* next = big_blocks->next;
+			free(big_blocks);
+			big_blocks = next;
+		}
+		reset();
+	}
+};
+
+
+#endif
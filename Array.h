@@ -1,19 +1,31 @@
 #ifndef _array_h
 #define _array_h
 #include <iostream>
-#include <cstdlib> // malloc, free
+#include <cstdlib> // malloc, realloc, free
+#include <cstring> // memcpy
+#include <type_traits> // is_trivially_copyable, integral_constant
+#include "ArrayView.h"
 #include "utility.h"
 
 
+// capacity is multiplied by this factor every time Array runs out of space, has to be above 1
+// smaller factor wastes less memory, larger one copies elements fewer times
+#ifndef ARRAY_GROWTH_FACTOR
+#define ARRAY_GROWTH_FACTOR 2.0
+#endif
+
+
 template <typename type>
 class Array
 {
 	s64 capacity; // allocated size
 	s64 count; // effective size
-	type *data; // container holding data
+	type *elements; // container holding elements
 
-	// will double everytime reaches limit
-	static const u32 INITIAL_CAPACITY = 64;
+	// memory is allocated on the first insertion, capacity then grows by ARRAY_GROWTH_FACTOR everytime reaches limit
+	static const u32 INITIAL_CAPACITY = 8;
+	// types which can be copied bytewise are moved to new memory by realloc, which often just extends the block
+	static const bool RELOCATABLE = std::is_trivially_copyable<type>::value;
 	
 	// friend definitions
 	friend class BigInt;
@@ -24,28 +36,99 @@ class Array
 	void destructInternalData()
 	{
 		// call destructor manually on all objects, since allocation and construction is done seperately
-		for (s64 i = 0; i < count; ++i) data[i].~type();
+		for (s64 i = 0; i < count; ++i) elements[i].~type();
 	}
 	
-	// default -1 means that double capacity will be used
-	void expandCapacity(s64 capacity = -1)
-	{
-		if (capacity > this->capacity) this->capacity = capacity;
-		else if (capacity == -1) this->capacity *= 2; 
-		else return;
+	// realloc path is chosen by overload (tag dispatch), so it's never instantiated for types which can't be copied bytewise
+	typedef std::integral_constant<bool, RELOCATABLE> relocatable;
 
-		if (((this->capacity * sizeof(type)) / this->capacity) != sizeof(type))
-			ERROR("Array capacity expansion failed, given capacity * type overflows");
+	// elements copied bytewise, realloc often just extends the block
+	type* moveToMemory(s64 capacity, std::true_type)
+	{
+		type* new_elements = (type*) realloc(elements, capacity * sizeof(type));
+		if (new_elements == nullptr) ERROR("Failed to allocate memory to expand Array object");
+		return new_elements;
+	}
 
-		type *new_data = (type*) malloc(this->capacity * sizeof(type));
-		if (new_data == nullptr) ERROR("Failed to allocate memory to expand Array object");
+	type* moveToMemory(s64 capacity, std::false_type)
+	{
+		type* new_elements = (type*) malloc(capacity * sizeof(type));
+		if (new_elements == nullptr) ERROR("Failed to allocate memory to expand Array object");
 
-		for (s64 i = 0; i < count; ++i) new(new_data + i) type(std::move(data[i]));
+		for (s64 i = 0; i < count; ++i) new(new_elements + i) type(std::move(elements[i]));
 		// just in case objects being moved only have copy constructor, so we have to explicitly destruct them afterwards
 		destructInternalData();
-		free(data);
+		free(elements);
+		return new_elements;
+	}
+
+	// moves elements to memory of given capacity, which can't be lower than count, 0 frees memory
+	void reallocate(s64 capacity)
+	{
+		if (capacity == 0)
+		{
+			free(elements);
+			elements = nullptr;
+			this->capacity = 0;
+			return;
+		}
+		if (((capacity * sizeof(type)) / capacity) != sizeof(type))
+			ERROR("Array capacity expansion failed, given capacity * type overflows");
+
+		elements = moveToMemory(capacity, relocatable());
+		this->capacity = capacity;
+	}
+
+	// copies amount values into uninitialized memory at destination
+	static void copyElements(type* destination, const type* values, s64 amount, std::true_type)
+	{
+		if (amount > 0) memcpy(destination, values, amount * sizeof(type));
+	}
+
+	static void copyElements(type* destination, const type* values, s64 amount, std::false_type)
+	{
+		for (s64 i = 0; i < amount; ++i) new(destination + i) type(values[i]);
+	}
+
+	// moves amount values into uninitialized memory at destination, values are left in moved from state
+	static void moveElements(type* destination, type* values, s64 amount, std::true_type)
+	{
+		if (amount > 0) memcpy(destination, values, amount * sizeof(type));
+	}
+
+	static void moveElements(type* destination, type* values, s64 amount, std::false_type)
+	{
+		for (s64 i = 0; i < amount; ++i) new(destination + i) type(std::move(values[i]));
+	}
+
+	// extending array with itself moved, elements can only be copied, as memory grows under them
+	Array<type> & extendWithSelf(std::true_type) { return extend((const Array<type> &)*this); }
 
-		data = new_data;
+	Array<type> & extendWithSelf(std::false_type)
+	{
+		ERROR("Array can't be extended with itself, its elements can't be copied");
+		return *this;
+	}
+
+	// default -1 means that capacity grows by ARRAY_GROWTH_FACTOR
+	void expandCapacity(s64 capacity = -1)
+	{
+		if (capacity == -1)
+		{
+			capacity = this->capacity == 0 ? INITIAL_CAPACITY : (s64)(this->capacity * ARRAY_GROWTH_FACTOR);
+			// factors close to 1 still have to grow small arrays
+			if (capacity <= this->capacity) capacity = this->capacity + 1;
+		}
+		if (capacity > this->capacity) reallocate(capacity);
+	}
+
+	// makes room for amount more elements at once, growing at least by ARRAY_GROWTH_FACTOR,
+	// so that appending many small ranges doesn't reallocate every time
+	void expandFor(s64 amount)
+	{
+		if (count + amount <= capacity) return;
+		s64 grown = (s64)(capacity * ARRAY_GROWTH_FACTOR);
+		expandCapacity(count + amount > grown ? count + amount : grown);
 	}
 
 	template <typename compareType = compare_less<type>> // end included
@@ -56,33 +139,33 @@ class Array
 		{
 			for (s64 i = start + 1; i <= end; ++i)
 			{
-				type el = std::move(data[i]);
+				type el = std::move(elements[i]);
 				s64 j = i - 1;
-				while (j >= start && compare(el, data[j]))
+				while (j >= start && compare(el, elements[j]))
 				{
-					data[j + 1] = std::move(data[j]);
+					elements[j + 1] = std::move(elements[j]);
 					--j;
 				}
-				data[j + 1] = std::move(el);
+				elements[j + 1] = std::move(el);
 			}
 			return;
 		}
 
 		// choose pivot
 		s64 pivot_index = start + rng.random() % (end - start + 1);
-		swap(data[start], data[pivot_index]);
-		type pivot = data[start];
+		swap(elements[start], elements[pivot_index]);
+		type pivot = elements[start];
 
 		s64 lt = start;
 		s64 gt = end + 1;
 		while (true)
 		{
-			while (compare(data[++lt], pivot));
-			while (compare(pivot, data[--gt]));
+			while (compare(elements[++lt], pivot));
+			while (compare(pivot, elements[--gt]));
 			if (lt >= gt) break;
-			swap(data[lt], data[gt]);
+			swap(elements[lt], elements[gt]);
 		}
-		swap(data[start], data[gt]);
+		swap(elements[start], elements[gt]);
 
 		quickSort(start, gt - 1, rng, compare);
 		quickSort(gt + 1, end, rng, compare);
@@ -95,14 +178,14 @@ class Array
 		{
 			for (s64 i = start + 1; i <= end; ++i)
 			{
-				type el = std::move(data[i]);
+				type el = std::move(elements[i]);
 				s64 j = i - 1;
-				while (j >= start && compare(el, data[j]))
+				while (j >= start && compare(el, elements[j]))
 				{
-					data[j + 1] = std::move(data[j]);
+					elements[j + 1] = std::move(elements[j]);
 					--j;
 				}
-				data[j + 1] = std::move(el);
+				elements[j + 1] = std::move(el);
 			}
 			return;
 		}
@@ -113,7 +196,7 @@ class Array
 
 		// optimize for when both sides are already sorted to skip merge
 		// if whole array is sorted, skipping merge makes sorting linear
-		if (compare(data[mid+1], data[mid]))
+		if (compare(elements[mid+1], elements[mid]))
 		{
 			// merge step
 			s64 lhs = start;
@@ -121,26 +204,21 @@ class Array
 			s64 len = end - start + 1;
 			for (s64 i = 0; i < len; ++i)
 			{
-				if (lhs == mid + 1)						aux[i] = std::move(data[rhs++]);
-				else if (rhs > end) 					aux[i] = std::move(data[lhs++]);
-				else if (compare(data[rhs], data[lhs]))	aux[i] = std::move(data[rhs++]);
-				else 									aux[i] = std::move(data[lhs++]);
+				if (lhs == mid + 1)						aux[i] = std::move(elements[rhs++]);
+				else if (rhs > end) 					aux[i] = std::move(elements[lhs++]);
+				else if (compare(elements[rhs], elements[lhs]))	aux[i] = std::move(elements[rhs++]);
+				else 									aux[i] = std::move(elements[lhs++]);
 			}
 			// transfer merged sides from auxiliary array back to actual array
-			for (s64 i = 0; i < len; ++i) data[start + i] = std::move(aux[i]);
+			for (s64 i = 0; i < len; ++i) elements[start + i] = std::move(aux[i]);
 		}
 	}
 
 
 public:
 
-	Array()
-	{
-		capacity = INITIAL_CAPACITY;
-		data = (type*) malloc(capacity * sizeof(type));
-		if (data == nullptr) ERROR("Failed to allocate memory to construct Array object");
-		count = 0;
-	}
+	// allocates nothing until first insertion, so empty arrays cost no memory
+	Array(): capacity(0), count(0), elements(nullptr) { /* empty */ }
 
 	// standard constructor just allocates memory, but does no object initialization (construction)
 	// this constructor allocates and initializes capacity amount of objects to given value (default if non given)
@@ -153,55 +231,44 @@ public:
 			ERROR("Array constructor failed, given capacity * type overflows");
 
 		this->capacity = capacity;
-		data = (type*) malloc(capacity * sizeof(type));
-		if (data == nullptr) ERROR("Failed to allocate memory to construct Array object");
+		elements = (type*) malloc(capacity * sizeof(type));
+		if (elements == nullptr) ERROR("Failed to allocate memory to construct Array object");
 
 		count = 0;
-		for (s64 i = 0; i < capacity; i++) new(data + count++) type(value);
+		for (s64 i = 0; i < capacity; i++) new(elements + count++) type(value);
 	}
 
 	// uniform initialization -  Array<float> arr = { 2.3, 2.4 ... }
-	Array(const std::initializer_list<type> & il)
+	Array(const std::initializer_list<type> & il): Array()
 	{
-		s64 size = il.size();
-		capacity = INITIAL_CAPACITY;
-		if (size > capacity) capacity = size * 2;
-		data = (type*)malloc(capacity * sizeof(type));
-
-		count = 0;
-		for (auto & el : il) new(data + count++) type(el);
+		reserve(il.size());
+		for (auto & el : il) new(elements + count++) type(el);
 	}
 
 	// for Array<char> initialization, that could be used like string
-	Array(const char *str)
+	Array(const char *str): Array()
 	{
 		// find out str size not including NULL
-		count = -1;
-		while (str[++count] != NULL);
-
-		capacity = INITIAL_CAPACITY;
-		if (count > capacity) capacity = count * 2;
-		data = (char*)malloc(capacity * sizeof(char));
+		s64 size = -1;
+		while (str[++size] != NULL);
 
-		for (s64 i = 0; i < count; ++i) data[i] = str[i];
+		reserve(size);
+		for (count = 0; count < size; ++count) elements[count] = str[count];
 	}
 
 	~Array()
 	{
 		destructInternalData();
 		count = 0;
-		free(data);
+		free(elements);
 	}
 
-	// copy constructor
-	Array(const Array<type> & arr)
+	// copy constructor, copy gets only as much memory as it needs
+	Array(const Array<type> & arr): Array()
 	{
-		capacity = arr.capacity;
-		data = (type*) malloc(capacity * sizeof(type));
-		if (data == nullptr) ERROR("Failed to allocate memory to copy Array object's data");
-
+		reserve(arr.count);
+		copyElements(elements, arr.elements, arr.count, relocatable());
 		count = arr.count;
-		for (s64 i = 0; i < count; ++i) new(data + i) type(arr.data[i]);
 	}
 
 	// move constructor
@@ -209,9 +276,9 @@ public:
 	{
 		capacity = arr.capacity;
 		count = arr.count;
-		data = arr.data;
+		elements = arr.elements;
 
-		arr.data = nullptr;
+		arr.elements = nullptr;
 		arr.count = 0;
 		arr.capacity = 0;
 	}
@@ -222,15 +289,15 @@ public:
 		// swap
 		s64 capacity_temp = capacity;
 		s64 count_temp = count;
-		type* data_temp = data;
+		type* data_temp = elements;
 
 		capacity = arr.capacity;
 		count = arr.count;
-		data = arr.data;
+		elements = arr.elements;
 
 		arr.capacity = capacity_temp;
 		arr.count = count_temp;
-		arr.data = data_temp;
+		arr.elements = data_temp;
 		// arr going out of scope will destruct old Array's object's data
 
 		return *this;
@@ -241,26 +308,91 @@ public:
 		if (capacity > this->capacity) expandCapacity(capacity);
 	}
 
-	// get or set element only through [] operator
+	// gives back memory not used by elements, empty array frees all of it
+	void shrink_to_fit()
+	{
+		if (capacity > count) reallocate(count);
+	}
+
+	// get or set element through [] operator, position is checked only in debug builds (NDEBUG not defined)
 	type & operator[](s64 position) const
 	{
+#ifndef NDEBUG
 		if (position < 0 || position >= count)
 			ERROR("%s (size %d) can't get element from %d position - out of range", typeid(*this).name(), this->count, position);
-		return data[position];
+#endif
+		return elements[position];
 	}
 
+	// same as [] operator, but position is checked in every build
+	type & at(s64 position) const
+	{
+		if (position < 0 || position >= count)
+			ERROR("%s (size %d) can't get element from %d position - out of range", typeid(*this).name(), this->count, position);
+		return elements[position];
+	}
+
+	// position is never checked, for inner loops which already keep within bounds
+	type & at_unchecked(s64 position) const { return elements[position]; }
+
+	type* data() { return elements; }
+	const type* data() const { return elements; }
+
+	// non owning views of all elements, invalidated once Array reallocates
+	ArrayView<type> view() const { return ArrayView<type>(elements, count); }
+	ArraySpan<type> span() { return ArraySpan<type>(elements, count); }
+
 	// begin of iterator for auto range based loop
-	type * begin() { return data; }
+	type * begin() { return elements; }
 
 	// end of iterator for auto range based loop
-	type * end() { return (data + count); }
+	type * end() { return (elements + count); }
 
 
-	// insert move type element to the end
-	void insert(type el)
+	// constructs element at the end from given constructor arguments, returns it
+	template <typename... Args>
+	type & emplace_back(Args&&... args)
 	{
-		if (count == capacity) expandCapacity();
-		new(data + count++) type(std::move(el));
+		if (count == capacity)
+		{
+			// arguments may refer to elements of this array, so element is made before they are moved away
+			type el(std::forward<Args>(args)...);
+			expandCapacity();
+			return *new(elements + count++) type(std::move(el));
+		}
+		return *new(elements + count++) type(std::forward<Args>(args)...);
+	}
+
+	// insert copy of element to the end
+	void insert(const type & el) { emplace_back(el); }
+
+	// insert moved element to the end
+	void insert(type && el) { emplace_back(std::move(el)); }
+
+	// appends copies of amount elements starting at values, memory is reserved once
+	// values can point into this array
+	void append_range(const type* values, s64 amount)
+	{
+		if (amount <= 0) return;
+		if (values >= elements && values < elements + count)
+		{
+			s64 offset = values - elements;
+			expandFor(amount);
+			values = elements + offset;
+		}
+		else expandFor(amount);
+
+		copyElements(elements + count, values, amount, relocatable());
+		count += amount;
+	}
+
+	// appends elements by moving them out of values, which are left in moved from state
+	void append_moved(type* values, s64 amount)
+	{
+		if (amount <= 0) return;
+		expandFor(amount);
+		moveElements(elements + count, values, amount, relocatable());
+		count += amount;
 	}
 
 	// insert type element to the specified position
@@ -272,14 +404,14 @@ public:
 
 		if (position == count)
 		{
-			new(data + count++) type(std::move(el));
+			new(elements + count++) type(std::move(el));
 			return;
 		}
 
-		new(data + count) type(std::move(data[count-1]));
+		new(elements + count) type(std::move(elements[count-1]));
 		for (s64 i = count - 2; i >= position; --i)
-			data[i + 1] = std::move(data[i]);
-		data[position] = std::move(el);
+			elements[i + 1] = std::move(elements[i]);
+		elements[position] = std::move(el);
 		count++;
 	}
 
@@ -288,7 +420,7 @@ public:
 	{
 		if (start > end || start < 0 || end > count)
 			ERROR("Array - fill method: given range [%d:%d) is wrong, array size is %d", start, end, count);
-		for (s64 i = start; i < end; ++i) data[i] = el;
+		for (s64 i = start; i < end; ++i) elements[i] = el;
 	}
 
 	// removes type element at specified position
@@ -302,18 +434,18 @@ public:
 		if (ordered)
 		{
 			for (s64 i = position; i < count - 1; ++i)
-				data[i] = std::move(data[i + 1]);
+				elements[i] = std::move(elements[i + 1]);
 		}
-		else data[position] = std::move(data[count - 1]);
+		else elements[position] = std::move(elements[count - 1]);
 
-		data[--count].~type();
+		elements[--count].~type();
 	}
 
 	// removes last element and returns it
 	type pop()
 	{
 		if (this->count == 0) ERROR("%s is empty container: can't pop element", typeid(*this).name());
-		type result = std::move(this->data[count-1]);
+		type result = std::move(this->elements[count-1]);
 		this->remove(count-1);
 		return result;
 	}
@@ -328,7 +460,7 @@ public:
 		if (start < 0 || start >= this->count || end <= start) return -1;
 
 		for (s64 i = start; i < end; ++i)
-			if (compare(data[i], value)) return i;
+			if (compare(elements[i], value)) return i;
 		return -1;
 	}
 
@@ -340,7 +472,7 @@ public:
 		for (s64 pos = size - 1; pos > 0; --pos)
 		{
 			s64 rand_pos = rng.random() % (pos + 1);
-			swap(data[pos], data[rand_pos]);
+			swap(elements[pos], elements[rand_pos]);
 		}
 	}
 
@@ -352,9 +484,9 @@ public:
 		const s64 size = this->count;
 		for (s64 i = 0; i < size - 1; ++i)
 		{
-			if (compare(data[i+1], data[i]))
+			if (compare(elements[i+1], elements[i]))
 			{
-				swap(data[i+1], data[i]);
+				swap(elements[i+1], elements[i]);
 				exchanged = true;
 			}
 		}
@@ -373,14 +505,28 @@ public:
 	}	
 
 	// returns copy of array from start to end (not included)
-	Array<type> subArray(s64 start = 0, s64 end = -1) const
+	Array<type> subArray(s64 start = 0, s64 end = -1) const &
+	{
+		if (end == -1) end = this->count;
+		if (start < 0 || start > this->count || end < start || end > this->count)
+			ERROR("Can't create subArray from %s (size %I64s), provided indexes %I64s - %I64s are out of range", typeid(*this).name(), this->count, start, end);
+
+		Array<type> result;
+		result.reserve(end - start);
+		result.append_range(this->elements + start, end - start);
+		return result;
+	}
+
+	// array about to be destroyed gives its elements from start to end (not included) away instead of copying them
+	Array<type> subArray(s64 start = 0, s64 end = -1) &&
 	{
 		if (end == -1) end = this->count;
-		if (start < 0 || start > this->count || end < start)
+		if (start < 0 || start > this->count || end < start || end > this->count)
 			ERROR("Can't create subArray from %s (size %I64s), provided indexes %I64s - %I64s are out of range", typeid(*this).name(), this->count, start, end);
 
 		Array<type> result;
-		for (s64 i = start; i < end; ++i) result.insert(this->data[i]);
+		result.reserve(end - start);
+		result.append_moved(this->elements + start, end - start);
 		return result;
 	}
 
@@ -396,19 +542,38 @@ public:
 
 	Array<type> & extend(const Array<type> & rhs)
 	{
-		for (const type & value : rhs)
-			this->insert(value);
+		this->append_range(rhs.elements, rhs.count);
+		return *this;
+	}
+
+	// elements of rhs are moved, empty array just takes its memory over, rhs is left empty
+	Array<type> & extend(Array<type> && rhs)
+	{
+		if (&rhs == this) return extendWithSelf(std::is_copy_constructible<type>());
+		if (this->count == 0 && rhs.capacity >= this->capacity)
+		{
+			*this = std::move(rhs);
+			return *this;
+		}
+		this->append_moved(rhs.elements, rhs.count);
+		// relocated elements have to be forgotten, not destructed
+		if (RELOCATABLE) rhs.count = 0;
+		else rhs.clear();
 		return *this;
 	}
 
 	// appends rhs array to this and returns new array
-	Array<type> operator+(const Array<type> & rhs)
+	Array<type> operator+(const Array<type> & rhs) const
 	{
-		Array<type> result(*this);
-		return result.extend(rhs);
+		Array<type> result;
+		result.reserve(this->count + rhs.count);
+		result.append_range(this->elements, this->count);
+		result.append_range(rhs.elements, rhs.count);
+		return result;
 	}
 
 	Array<type> & operator+=(const Array<type> & rhs) { return this->extend(rhs); }
+	Array<type> & operator+=(Array<type> && rhs) { return this->extend(std::move(rhs)); }
 
 	Array<type> & operator+=(const type & value)
 	{
@@ -422,7 +587,7 @@ public:
 		if (size != rhs.size()) return false;
 
 		for (s64 i = 0; i < size; ++i)
-			if (this[i] != rhs[i]) return false;
+			if (elements[i] != rhs.elements[i]) return false;
 		return true;
 	}
 
@@ -435,11 +600,11 @@ public:
 		s64 size = arr.count;
 		if (typeid(type) == typeid(char))
 		{
-			for (s64 i = 0; i < size; ++i) os << arr.data[i];
+			for (s64 i = 0; i < size; ++i) os << arr.elements[i];
 			return os;
 		}
 		os << "Array (size " << size << "): ";
-		for (s64 i = 0; i < size; ++i) os << arr.data[i] << " ";
+		for (s64 i = 0; i < size; ++i) os << arr.elements[i] << " ";
 		return os;
 	}
 };
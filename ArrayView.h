@@ -0,0 +1,91 @@
+#ifndef _arrayview_h
+#define _arrayview_h
+
+#include <utility> // move
+#include "utility.h"
+
+
+// non owning views of contiguous elements, just pointer and length, cheap to pass by value
+// they point into memory of an Array (or any other contiguous storage) and are invalidated when it reallocates
+// operator[] checks bounds only in debug builds (NDEBUG not defined), at_unchecked never does
+
+// read only view
+template <typename type>
+class ArrayView
+{
+	const type* elements;
+	s64 count;
+
+public:
+	ArrayView(): elements(nullptr), count(0) { /* empty */ }
+	ArrayView(const type* elements, s64 count): elements(elements), count(count) { /* empty */ }
+
+	const type & operator[](s64 position) const
+	{
+#ifndef NDEBUG
+		if (position < 0 || position >= count)
+			ERROR("ArrayView (size %lld) can't get element from %lld position - out of range", count, position);
+#endif
+		return elements[position];
+	}
+
+	const type & at_unchecked(s64 position) const { return elements[position]; }
+	const type* data() const { return elements; }
+
+	inline s64 size() const { return count; }
+	inline bool isEmpty() const { return count == 0; }
+
+	const type* begin() const { return elements; }
+	const type* end() const { return elements + count; }
+
+	// returns view of elements from start to end (not included)
+	ArrayView subView(s64 start, s64 end) const
+	{
+		if (start < 0 || start > end || end > count)
+			ERROR("ArrayView (size %lld) can't make view of [%lld:%lld) range", count, start, end);
+		return ArrayView(elements + start, end - start);
+	}
+};
+
+// view allowing to change elements, but not their amount
+template <typename type>
+class ArraySpan
+{
+	type* elements;
+	s64 count;
+
+public:
+	ArraySpan(): elements(nullptr), count(0) { /* empty */ }
+	ArraySpan(type* elements, s64 count): elements(elements), count(count) { /* empty */ }
+
+	type & operator[](s64 position) const
+	{
+#ifndef NDEBUG
+		if (position < 0 || position >= count)
+			ERROR("ArraySpan (size %lld) can't get element from %lld position - out of range", count, position);
+#endif
+		return elements[position];
+	}
+
+	type & at_unchecked(s64 position) const { return elements[position]; }
+	type* data() const { return elements; }
+
+	inline s64 size() const { return count; }
+	inline bool isEmpty() const { return count == 0; }
+
+	type* begin() const { return elements; }
+	type* end() const { return elements + count; }
+
+	// returns span of elements from start to end (not included)
+	ArraySpan subSpan(s64 start, s64 end) const
+	{
+		if (start < 0 || start > end || end > count)
+			ERROR("ArraySpan (size %lld) can't make span of [%lld:%lld) range", count, start, end);
+		return ArraySpan(elements + start, end - start);
+	}
+
+	operator ArrayView<type>() const { return ArrayView<type>(elements, count); }
+};
+
+
+#endif
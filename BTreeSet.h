@@ -0,0 +1,523 @@
+#ifndef _btreeset_h
+#define _btreeset_h
+
+#include <cstring> // memmove
+#include <initializer_list>
+#include <new> // placement new
+#include <utility> // move
+#include "utility.h"
+
+
+// Set implemented as B-tree
+// every node holds up to MAX_KEYS sorted keys laid out next to each other, so a lookup touches
+// a few cache lines per level and the tree is only log(n) / log(MAX_KEYS) levels high
+// all leaves are at the same depth, insert, remove and contains are O(log n) whatever the insertion order
+// has Set's interface, unlike with Set any insert or remove invalidates iterators
+template <typename type, typename compareType = compare_to<type>>
+class BTreeSet
+{
+	// keys of a node take about this many bytes (4 cache lines)
+	static const s64 NODE_BYTES = 256;
+	// odd, so that a full node splits into two nodes of MIN_KEYS keys and a median moved to the parent
+	static const s64 MAX_KEYS = sizeof(type) * 3 >= NODE_BYTES ? 3 : ((NODE_BYTES / sizeof(type)) | 1);
+	static const s64 MIN_KEYS = MAX_KEYS / 2;
+
+	struct Node
+	{
+		Node* parent;
+		u16 count;
+		bool leaf;
+		// keys are constructed in place, only first count are alive
+		alignas(type) char storage[sizeof(type) * MAX_KEYS];
+
+		Node(bool leaf, Node* parent = nullptr): parent(parent), count(0), leaf(leaf) { /* empty */ }
+
+		type* keys() { return (type*)storage; }
+		const type* keys() const { return (const type*)storage; }
+	};
+
+	// leaves don't carry children pointers
+	struct InnerNode : Node
+	{
+		Node* children[MAX_KEYS + 1];
+
+		InnerNode(Node* parent = nullptr): Node(false, parent) { /* empty */ }
+	};
+
+	Node* root;
+	// returns 1 if 1st element is bigger than 2nd, 0 if equal, -1 if 2nd is bigger than 1st
+	compareType compare;
+	s64 nodeCount; // size of Set (amount of keys, not nodes)
+
+	static Node*& child(Node* node, s64 index) { return ((InnerNode*)node)->children[index]; }
+
+	// returns index of the first key not smaller than value, sets found if it's equal to value
+	static s64 lowerBound(const Node* node, const type & value, const compareType & compare, bool & found)
+	{
+		s64 low = 0, high = node->count;
+		while (low < high)
+		{
+			s64 middle = (low + high) / 2;
+			if (compare(node->keys()[middle], value) < 0) low = middle + 1;
+			else high = middle;
+		}
+		found = low < node->count && compare(node->keys()[low], value) == 0;
+		return low;
+	}
+
+	// returns node containing value and sets index to its position, nullptr if value is not present
+	static Node* findNode(Node* tree, const type & value, const compareType & compare, s64 & index)
+	{
+		while (tree != nullptr)
+		{
+			bool found;
+			index = lowerBound(tree, value, compare, found);
+			if (found) return tree;
+			tree = tree->leaf ? nullptr : child(tree, index);
+		}
+		return nullptr;
+	}
+
+	static Node* findMin(Node* tree)
+	{
+		if (tree == nullptr) return nullptr;
+
+		while (!tree->leaf) tree = child(tree, 0);
+		return tree;
+	}
+
+	static Node* findMax(Node* tree)
+	{
+		if (tree == nullptr) return nullptr;
+
+		while (!tree->leaf) tree = child(tree, tree->count);
+		return tree;
+	}
+
+	// returns index of node within its parent's children
+	static s64 childIndex(const Node* node)
+	{
+		const Node* parent = node->parent;
+		s64 index = 0;
+		while (child((Node*)parent, index) != node) ++index;
+		return index;
+	}
+
+	// moves to the next key in order, node becomes nullptr after the largest key
+	static void successor(Node* & node, s64 & index)
+	{
+		if (!node->leaf)
+		{
+			node = findMin(child(node, index + 1));
+			index = 0;
+			return;
+		}
+		++index;
+		while (node != nullptr && index == node->count)
+		{
+			if (node->parent == nullptr) node = nullptr;
+			else
+			{
+				index = childIndex(node);
+				node = node->parent;
+			}
+		}
+	}
+
+	// inserts value at index, shifting following keys right, node can't be full
+	static void insertKey(Node* node, s64 index, type value)
+	{
+		type* keys = node->keys();
+		if (index == node->count) new (keys + index) type(std::move(value));
+		else
+		{
+			new (keys + node->count) type(std::move(keys[node->count - 1]));
+			for (s64 i = node->count - 1; i > index; --i) keys[i] = std::move(keys[i - 1]);
+			keys[index] = std::move(value);
+		}
+		node->count += 1;
+	}
+
+	// removes key at index, shifting following keys left
+	static void eraseKey(Node* node, s64 index)
+	{
+		type* keys = node->keys();
+		for (s64 i = index; i + 1 < node->count; ++i) keys[i] = std::move(keys[i + 1]);
+		keys[node->count - 1].~type();
+		node->count -= 1;
+	}
+
+	// moves count keys starting at from's index to the end of to
+	static void moveKeys(Node* to, Node* from, s64 index, s64 count)
+	{
+		for (s64 i = 0; i < count; ++i)
+		{
+			new (to->keys() + to->count + i) type(std::move(from->keys()[index + i]));
+			from->keys()[index + i].~type();
+		}
+		to->count += (u16)count;
+	}
+
+	// moves count children starting at from's index to the end of to (whose keys count is already updated)
+	static void moveChildren(Node* to, s64 to_index, Node* from, s64 index, s64 count)
+	{
+		for (s64 i = 0; i < count; ++i)
+		{
+			child(to, to_index + i) = child(from, index + i);
+			child(to, to_index + i)->parent = to;
+		}
+	}
+
+	// splits full child at index into two, its median key moves up into parent
+	static void splitChild(Node* parent, s64 index)
+	{
+		Node* left = child(parent, index);
+		Node* right = left->leaf ? new Node(true, parent) : new InnerNode(parent);
+
+		moveKeys(right, left, MIN_KEYS + 1, MIN_KEYS);
+		if (!left->leaf) moveChildren(right, 0, left, MIN_KEYS + 1, MIN_KEYS + 1);
+		left->count = MIN_KEYS + 1;
+
+		// make room for new child and median key in parent
+		memmove(&child(parent, index + 2), &child(parent, index + 1), sizeof(Node*) * (parent->count - index));
+		child(parent, index + 1) = right;
+		insertKey(parent, index, std::move(left->keys()[MIN_KEYS]));
+		eraseKey(left, MIN_KEYS);
+	}
+
+	// returns true if value was not present in container, false otherwhise
+	// full nodes are split on the way down, so there is always room for the key when a leaf is reached
+	bool insertNode(const type & value)
+	{
+		if (root == nullptr) root = new Node(true);
+		if (root->count == MAX_KEYS)
+		{
+			InnerNode* new_root = new InnerNode();
+			new_root->children[0] = root;
+			root->parent = new_root;
+			root = new_root;
+			splitChild(root, 0);
+		}
+
+		Node* current = root;
+		while (true)
+		{
+			bool found;
+			s64 index = lowerBound(current, value, compare, found);
+			if (found) return false;
+			if (current->leaf)
+			{
+				insertKey(current, index, value);
+				nodeCount += 1;
+				return true;
+			}
+
+			if (child(current, index)->count == MAX_KEYS)
+			{
+				splitChild(current, index);
+				int cmp = compare(value, current->keys()[index]);
+				if (cmp == 0) return false;
+				if (cmp > 0) index += 1;
+			}
+			current = child(current, index);
+		}
+	}
+
+	// refills node having less than MIN_KEYS keys by borrowing a key from a sibling or merging with it
+	// merging takes a key from parent, so parent is checked afterwards as well
+	void rebalance(Node* node)
+	{
+		while (node != root && node->count < MIN_KEYS)
+		{
+			Node* parent = node->parent;
+			const s64 index = childIndex(node);
+			Node* left = index > 0 ? child(parent, index - 1) : nullptr;
+			Node* right = index < parent->count ? child(parent, index + 1) : nullptr;
+
+			if (left != nullptr && left->count > MIN_KEYS)
+			{
+				// rotate right: parent's separator moves down into node, left's largest key replaces it
+				insertKey(node, 0, std::move(parent->keys()[index - 1]));
+				parent->keys()[index - 1] = std::move(left->keys()[left->count - 1]);
+				if (!node->leaf)
+				{
+					memmove(&child(node, 1), &child(node, 0), sizeof(Node*) * node->count);
+					child(node, 0) = child(left, left->count);
+					child(node, 0)->parent = node;
+				}
+				eraseKey(left, left->count - 1);
+				return;
+			}
+			if (right != nullptr && right->count > MIN_KEYS)
+			{
+				// rotate left: parent's separator moves down into node, right's smallest key replaces it
+				insertKey(node, node->count, std::move(parent->keys()[index]));
+				parent->keys()[index] = std::move(right->keys()[0]);
+				if (!node->leaf)
+				{
+					child(node, node->count) = child(right, 0);
+					child(node, node->count)->parent = node;
+					memmove(&child(right, 0), &child(right, 1), sizeof(Node*) * right->count);
+				}
+				eraseKey(right, 0);
+				return;
+			}
+
+			// merge with a sibling, both have at most MIN_KEYS keys, so together with separator they fit
+			const s64 separator = left != nullptr ? index - 1 : index;
+			Node* into = child(parent, separator);
+			Node* from = child(parent, separator + 1);
+			insertKey(into, into->count, std::move(parent->keys()[separator]));
+			const s64 children_start = into->count;
+			moveKeys(into, from, 0, from->count);
+			if (!into->leaf) moveChildren(into, children_start, from, 0, into->count - children_start + 1);
+			deleteNode(from);
+
+			eraseKey(parent, separator);
+			memmove(&child(parent, separator + 1), &child(parent, separator + 2), sizeof(Node*) * (parent->count - separator));
+			node = parent;
+		}
+
+		// root left without keys is replaced by its only child or removed
+		if (root->count == 0)
+		{
+			Node* old_root = root;
+			root = root->leaf ? nullptr : child(root, 0);
+			if (root != nullptr) root->parent = nullptr;
+			deleteNode(old_root);
+		}
+	}
+
+	// returns true if value is succesfully removed, false otherwhise
+	bool removeNode(const type & value)
+	{
+		s64 index;
+		Node* node = findNode(root, value, compare, index);
+		if (node == nullptr) return false;
+
+		// key in inner node is replaced by its predecessor, which is always in a leaf
+		if (!node->leaf)
+		{
+			Node* leaf = findMax(child(node, index));
+			node->keys()[index] = std::move(leaf->keys()[leaf->count - 1]);
+			node = leaf;
+			index = leaf->count - 1;
+		}
+		eraseKey(node, index);
+		nodeCount -= 1;
+		rebalance(node);
+		return true;
+	}
+
+	// frees node without destructing any keys or children
+	static void deleteNode(Node* node)
+	{
+		if (node->leaf) delete node;
+		else delete (InnerNode*)node;
+	}
+
+	static void clearTree(Node* tree)
+	{
+		if (tree == nullptr) return;
+
+		if (!tree->leaf)
+			for (s64 i = 0; i <= tree->count; ++i) clearTree(child(tree, i));
+		for (s64 i = 0; i < tree->count; ++i) tree->keys()[i].~type();
+		deleteNode(tree);
+	}
+
+	// creates a copy of the provided tree and returns new tree's root
+	static Node* copyTree(const Node* tree, Node* parent = nullptr)
+	{
+		if (tree == nullptr) return nullptr;
+
+		Node* copy = tree->leaf ? new Node(true, parent) : new InnerNode(parent);
+		for (s64 i = 0; i < tree->count; ++i) new (copy->keys() + i) type(tree->keys()[i]);
+		copy->count = tree->count;
+		if (!tree->leaf)
+			for (s64 i = 0; i <= tree->count; ++i) child(copy, i) = copyTree(child((Node*)tree, i), copy);
+		return copy;
+	}
+
+	static int treeHeight(const Node* tree)
+	{
+		if (tree == nullptr) return -1;
+
+		int height = 0;
+		while (!tree->leaf) { tree = child((Node*)tree, 0); ++height; }
+		return height;
+	}
+
+public:
+
+	class iterator //: public std::iterator<std::input_iterator_tag, type>
+	{
+		const BTreeSet* set;
+		// node and index of the key to return, node is nullptr at the end
+		Node* pos;
+		s64 index;
+	public:
+		// default non usable constructor, which returns invalid iterator
+		iterator() : set(nullptr), pos(nullptr), index(0) { /* empty */ }
+
+		// end indicates to initialize end iterator
+		iterator(const BTreeSet* set, bool end = false)
+		{
+			this->set = set;
+			this->pos = end ? nullptr : findMin(set->root);
+			this->index = 0;
+		}
+
+		// copy constructor
+		iterator(const iterator & it)
+		{
+			this->set = it.set;
+			this->pos = it.pos;
+			this->index = it.index;
+		}
+
+		iterator & operator++()
+		{
+			successor(pos, index);
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator result(*this);
+			++(*this);
+			return result;
+		}
+
+		const type & operator*() { return pos->keys()[index]; }
+		const type* operator->() { return pos->keys() + index; }
+
+		bool operator==(const iterator & it) const
+			{ return this->set == it.set && this->pos == it.pos && (this->pos == nullptr || this->index == it.index); }
+		bool operator!=(const iterator & it) const { return !(*this == it); }
+	};
+
+	// constructor
+	BTreeSet(): root(nullptr), compare(), nodeCount(0) { /* empty */ }
+
+	// uniform initialization -  BTreeSet<float> set = { 2.3, 2.4 ... }
+	BTreeSet(const std::initializer_list<type> & il): BTreeSet()
+		{ for (auto & el : il) this->insert(el); }
+
+	// copy constructor
+	BTreeSet(const BTreeSet & set): root(copyTree(set.root)), compare(set.compare), nodeCount(set.nodeCount) { /* empty */ }
+
+	// move constructor
+	BTreeSet(BTreeSet && set): root(set.root), compare(set.compare), nodeCount(set.nodeCount)
+	{
+		set.root = nullptr;
+		set.nodeCount = 0;
+	}
+
+	// copy/move assignment
+	BTreeSet & operator=(BTreeSet set)
+	{
+		::swap(root, set.root);
+		::swap(compare, set.compare);
+		::swap(nodeCount, set.nodeCount);
+		// set going out of scope will destruct old tree
+		return *this;
+	}
+
+	// destructor
+	~BTreeSet() { clear(); }
+
+	type min() { Node* node = findMin(root); return node->keys()[0]; }
+	type max() { Node* node = findMax(root); return node->keys()[node->count - 1]; }
+	bool insert(const type & value) { return insertNode(value); }
+	bool contains(const type & value) const { s64 index; return findNode(root, value, compare, index) != nullptr; }
+	bool remove(const type & value) { return removeNode(value); }
+	void clear() { clearTree(root); nodeCount = 0; root = nullptr; }
+	inline s64 size() const { return nodeCount; }
+	inline bool isEmpty() const { return nodeCount == 0; }
+	iterator begin() const { return iterator(this); }
+	iterator end() const { return iterator(this, /*end*/ true); }
+
+	// amount of levels below root, every leaf is at this depth
+	int height() const { return treeHeight(root); }
+
+
+
+	// SET OPERATIONS
+
+	// set union
+	BTreeSet operator+(const BTreeSet & rhs) const
+	{
+		BTreeSet set(*this);
+		for (const type & value : rhs)
+			set.insert(value);
+		return set;
+	}
+
+	BTreeSet & operator+=(const BTreeSet & rhs)
+	{
+		for (const type & value : rhs)
+			this->insert(value);
+		return *this;
+	}
+
+	// set intersection
+	BTreeSet operator*(const BTreeSet & rhs) const
+	{
+		BTreeSet set;
+		for (const type & value : rhs)
+		{
+			if (this->contains(value))
+				set.insert(value);
+		}
+		return set;
+	}
+
+	// set difference
+	BTreeSet operator-(const BTreeSet & rhs) const
+	{
+		BTreeSet set;
+		for (const type & value : *this)
+		{
+			if (!rhs.contains(value))
+				set.insert(value);
+		}
+		return set;
+	}
+
+	BTreeSet & operator-=(const BTreeSet & rhs)
+	{
+		for (const type & value : rhs)
+			this->remove(value);
+		return *this;
+	}
+
+	bool isSubsetOf(const BTreeSet & rhs) const
+	{
+		if (this->size() > rhs.size()) return false;
+		for (const type & value : *this)
+		{
+			if (!rhs.contains(value)) return false;
+		}
+		return true;
+	}
+
+	bool isSupersetOf(const BTreeSet & rhs) const { return rhs.isSubsetOf(*this); }
+
+	// equal sets have equal sizes and the same keys in the same order
+	bool operator==(const BTreeSet & rhs) const
+	{
+		if (this->size() != rhs.size()) return false;
+		iterator it = rhs.begin();
+		for (const type & value : *this)
+		{
+			if (compare(value, *it) != 0) return false;
+			++it;
+		}
+		return true;
+	}
+
+	bool operator!=(const BTreeSet & rhs) const { return !(*this == rhs); }
+};
+
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef _compactset_h
+#define _compactset_h
+
+#include <cmath> // sqrt
+#include <type_traits> // is_trivially_copyable
+#include "Array.h"
+#include "utility.h"
+
+
+// ordered set of trivially copyable values kept in one sorted Array, no per value node
+// Set<s32> spends around 64 bytes per value on its node and malloc, CompactSet spends 4 (up to 8 while Array grows)
+// inserts and removals go to small sorted buffers first, which are merged into the main array once
+// one of them outgrows sqrt of its size, so merging costs O(sqrt n) per operation amortized
+// contains is a binary search in the main array and in the buffers, O(log n)
+// const access never modifies the set, iteration walks main array and buffers together, skipping removed values
+// compact merges pending buffers, so that following iteration and min / max walk plain sorted memory
+// like other containers here, set isn't thread safe, concurrent readers are fine only while nobody modifies it
+template <typename type, typename compareType = compare_to<type>>
+class CompactSet
+{
+	static_assert(std::is_trivially_copyable<type>::value, "CompactSet: type has to be trivially copyable");
+
+	// buffers can always hold at least this many values before being merged
+	static const s64 MIN_BUFFER = 64;
+
+	Array<type> values; // sorted, merged values
+	Array<type> inserted; // sorted, values not present in values
+	Array<type> removed; // sorted, values present in values which are removed
+	// returns 1 if 1st element is bigger than 2nd, 0 if equal, -1 if 2nd is bigger than 1st
+	compareType compare;
+
+	// end of values of const arr, Array has no const begin / end
+	static const type* endOf(const Array<type> & arr) { return arr.data() + arr.size(); }
+
+	// returns position of the first value not smaller than value within sorted arr
+	s64 lowerBound(const Array<type> & arr, const type & value) const
+	{
+		const type* data = arr.data();
+		s64 start = 0, end = arr.size();
+		while (start < end)
+		{
+			s64 middle = start + (end - start) / 2;
+			if (compare(data[middle], value) < 0) start = middle + 1;
+			else end = middle;
+		}
+		return start;
+	}
+
+	// returns position of value within sorted arr or -1 if it isn't there
+	s64 position(const Array<type> & arr, const type & value) const
+	{
+		s64 pos = lowerBound(arr, value);
+		return pos < arr.size() && compare(arr.data()[pos], value) == 0 ? pos : -1;
+	}
+
+	s64 bufferLimit() const
+	{
+		s64 limit = (s64)std::sqrt((double)values.size());
+		return limit > MIN_BUFFER ? limit : MIN_BUFFER;
+	}
+
+public:
+
+	// merges buffers into values in place, O(n), invalidates iterators
+	// removed values are squeezed out going forward, then inserted ones are merged in going backward from the end
+	void compact()
+	{
+		if (!removed.isEmpty())
+		{
+			type* data = values.begin();
+			const type* gone = removed.begin();
+			s64 kept = 0, r = 0;
+			for (s64 i = 0; i < values.size(); ++i)
+			{
+				if (r < removed.size() && compare(data[i], gone[r]) == 0) r += 1;
+				else data[kept++] = data[i];
+			}
+			while (values.size() > kept) values.pop();
+			removed.clear();
+		}
+
+		if (!inserted.isEmpty())
+		{
+			s64 old_size = values.size();
+			// placeholders are overwritten by the merge, Array grows by its usual doubling
+			for (s64 i = 0; i < inserted.size(); ++i) values.insert(inserted.begin()[0]);
+
+			type* data = values.begin();
+			const type* fresh = inserted.begin();
+			s64 i = old_size - 1, j = inserted.size() - 1;
+			for (s64 write = values.size() - 1; j >= 0; --write)
+			{
+				if (i >= 0 && compare(data[i], fresh[j]) > 0) data[write] = data[i--];
+				else data[write] = fresh[j--];
+			}
+			inserted.clear();
+		}
+	}
+
+	// walks sorted values and inserted buffer side by side, skipping values in removed buffer
+	// invalidated by insert, remove and compact
+	class iterator //: public std::iterator<std::input_iterator_tag, type>
+	{
+		const CompactSet* set;
+		// positions within values, removed and inserted, end iterator has all of them at their ends
+		const type* value;
+		const type* gone;
+		const type* fresh;
+
+		// moves past values which are removed, removed buffer holds only values present in values
+		void skipRemoved()
+		{
+			const type* values_end = endOf(set->values);
+			const type* removed_end = endOf(set->removed);
+			while (value != values_end && gone != removed_end && set->compare(*value, *gone) == 0)
+			{
+				++value;
+				++gone;
+			}
+		}
+
+		// true if the current value comes from inserted buffer, buffers never share a value with values
+		bool atFresh() const
+		{
+			if (fresh == endOf(set->inserted)) return false;
+			return value == endOf(set->values) || set->compare(*fresh, *value) < 0;
+		}
+
+	public:
+		// default non usable constructor, which returns invalid iterator
+		iterator() : set(nullptr), value(nullptr), gone(nullptr), fresh(nullptr) { /* empty */ }
+
+		// end indicates to initialize end iterator
+		iterator(const CompactSet* set, bool end = false)
+		{
+			this->set = set;
+			this->value = end ? endOf(set->values) : set->values.data();
+			this->gone = end ? endOf(set->removed) : set->removed.data();
+			this->fresh = end ? endOf(set->inserted) : set->inserted.data();
+			if (!end) skipRemoved();
+		}
+
+		iterator & operator++()
+		{
+			if (atFresh()) ++fresh;
+			else
+			{
+				++value;
+				skipRemoved();
+			}
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator result(*this);
+			++(*this);
+			return result;
+		}
+
+		const type & operator*() const { return atFresh() ? *fresh : *value; }
+		const type* operator->() const { return atFresh() ? fresh : value; }
+
+		bool operator==(const iterator & it) const { return value == it.value && fresh == it.fresh; }
+		bool operator!=(const iterator & it) const { return !(*this == it); }
+	};
+
+	// constructor
+	CompactSet(): values(), inserted(), removed(), compare() { /* empty */ }
+
+	// uniform initialization -  CompactSet<s32> set = { 2, 3 ... }
+	CompactSet(const std::initializer_list<type> & il): CompactSet()
+		{ for (auto & el : il) this->insert(el); }
+
+	// copy constructor
+	CompactSet(const CompactSet & set): values(set.values), inserted(set.inserted), removed(set.removed), compare(set.compare) { /* empty */ }
+
+	// move constructor
+	CompactSet(CompactSet && set): values(std::move(set.values)), inserted(std::move(set.inserted)),
+		removed(std::move(set.removed)), compare(set.compare) { /* empty */ }
+
+	// copy/move assignment
+	CompactSet & operator=(CompactSet set)
+	{
+		::swap(this->values, set.values);
+		::swap(this->inserted, set.inserted);
+		::swap(this->removed, set.removed);
+		::swap(this->compare, set.compare);
+		return *this;
+	}
+
+	// returns true if value was not present in container, false otherwhise
+	bool insert(const type & value)
+	{
+		if (position(values, value) != -1)
+		{
+			// value removed earlier is just brought back
+			s64 pos = position(removed, value);
+			if (pos == -1) return false;
+			removed.remove(pos);
+			return true;
+		}
+
+		s64 pos = lowerBound(inserted, value);
+		if (pos < inserted.size() && compare(inserted.begin()[pos], value) == 0) return false;
+		inserted.insert(value, pos);
+		if (inserted.size() > bufferLimit()) compact();
+		return true;
+	}
+
+	bool contains(const type & value) const
+	{
+		if (position(values, value) != -1) return position(removed, value) == -1;
+		return position(inserted, value) != -1;
+	}
+
+	// returns true if value was present in container, false otherwhise
+	bool remove(const type & value)
+	{
+		s64 pos = position(inserted, value);
+		if (pos != -1)
+		{
+			inserted.remove(pos);
+			return true;
+		}
+
+		if (position(values, value) == -1) return false;
+		pos = lowerBound(removed, value);
+		if (pos < removed.size() && compare(removed.begin()[pos], value) == 0) return false;
+		removed.insert(value, pos);
+		if (removed.size() > bufferLimit()) compact();
+		return true;
+	}
+
+	type min() const
+	{
+		if (isEmpty()) ERROR("CompactSet: min of an empty set");
+		return *begin();
+	}
+
+	// largest value not removed from values, or the last inserted one if that is bigger
+	type max() const
+	{
+		if (isEmpty()) ERROR("CompactSet: max of an empty set");
+		const type* value = endOf(values);
+		const type* gone = endOf(removed);
+		while (gone != removed.data() && compare(value[-1], gone[-1]) == 0)
+		{
+			--value;
+			--gone;
+		}
+		if (inserted.isEmpty()) return value[-1];
+		const type & last = inserted.data()[inserted.size() - 1];
+		return value == values.data() || compare(last, value[-1]) > 0 ? last : value[-1];
+	}
+
+	void clear()
+	{
+		values.clear();
+		inserted.clear();
+		removed.clear();
+	}
+
+	inline s64 size() const { return values.size() + inserted.size() - removed.size(); }
+	inline bool isEmpty() const { return size() == 0; }
+
+	iterator begin() const { return iterator(this); }
+	iterator end() const { return iterator(this, true); }
+
+	bool operator==(const CompactSet & rhs) const
+	{
+		if (this->size() != rhs.size()) return false;
+		iterator rhs_pos = rhs.begin();
+		for (iterator lhs_pos = this->begin(), lhs_end = this->end(); lhs_pos != lhs_end; ++lhs_pos, ++rhs_pos)
+			if (compare(*lhs_pos, *rhs_pos) != 0) return false;
+		return true;
+	}
+
+	bool operator!=(const CompactSet & rhs) const { return !(*this == rhs); }
+};
+
+
+#endif
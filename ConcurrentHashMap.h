@@ -0,0 +1,251 @@
+#ifndef _concurrenthashmap_h
+#define _concurrenthashmap_h
+
+#include <mutex> // unique_lock
+#include <shared_mutex> // shared_mutex, shared_lock
+#include "HashMap.h"
+#include "Array.h"
+#include "utility.h"
+
+
+// hash map safe to use from multiple threads at once
+// split into 2^n shards, each one a HashMap guarded by its own reader/writer lock
+// shard is chosen by the highest bits of key's hash, so threads working on different keys rarely wait for each other
+// values are copied out under the lock, references into the map are never handed out
+template <typename Key, typename Value, typename Hash = hash_of<Key>, typename Eq = key_equal<Key>>
+class ConcurrentHashMap
+{
+	typedef HashMap<Key, Value, Hash, Eq> map_type;
+	typedef key_traits<Key> traits;
+	typedef typename traits::view key_view;
+
+	// aligned to cache line, so that locks of neighbouring shards don't share one
+	struct alignas(64) shard
+	{
+		mutable std::shared_mutex lock;
+		map_type map;
+	};
+
+	shard* Shards;
+	u32 shard_bits; // amount of shards is 2^shard_bits
+
+	Hash hasher;
+	// shared by all shards, shards are handed hashes computed here
+	u64 seed;
+
+	static const u32 DEFAULT_SHARDS = 64;
+
+	u64 hash_key(key_view key) const { return traits::hash(hasher, key, seed); }
+
+	// HashMap positions keys by lower bits of the hash, so upper ones are free to choose a shard
+	static s64 shard_index(u64 hash, u32 shard_bits) { return shard_bits == 0 ? 0 : (s64)(hash >> (64 - shard_bits)); }
+
+public:
+
+	// copy of every shard, each one taken under its own lock
+	// changes done to other shards while copying may or may not be seen
+	class snapshot_map
+	{
+		friend class ConcurrentHashMap;
+
+		Array<map_type> maps;
+		u32 shard_bits;
+		Hash hasher;
+		u64 seed;
+
+		snapshot_map(u32 shard_bits, const Hash & hasher, u64 seed): maps(), shard_bits(shard_bits), hasher(hasher), seed(seed) { /* empty */ }
+
+		const map_type & map_of(key_view key, u64 & hash) const
+		{
+			hash = traits::hash(hasher, key, seed);
+			return maps[shard_index(hash, shard_bits)];
+		}
+
+	public:
+
+		class iterator //: public std::iterator<std::input_iterator_tag, Key>
+		{
+			const snapshot_map* snap;
+			s64 index; // shard iterated through
+			typename map_type::iterator pos;
+
+			// moves to the next shard while current one is exhausted
+			void skip_exhausted()
+			{
+				while (index < snap->maps.size() && pos == snap->maps[index].end())
+				{
+					++index;
+					if (index < snap->maps.size()) pos = snap->maps[index].begin();
+				}
+			}
+
+		public:
+
+			// default non usable constructor, which returns invalid iterator
+			iterator(): snap(nullptr), index(0), pos() { /* empty */ }
+
+			// end indicates to initialize end iterator
+			iterator(const snapshot_map* snap, bool end = false): snap(snap), pos()
+			{
+				index = end ? snap->maps.size() : 0;
+				if (index < snap->maps.size())
+				{
+					pos = snap->maps[index].begin();
+					skip_exhausted();
+				}
+			}
+
+			iterator & operator++()
+			{
+				++pos;
+				skip_exhausted();
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				iterator result(*this);
+				++(*this);
+				return result;
+			}
+
+			typename traits::reference operator*() const { return *pos; }
+
+			bool operator==(const iterator & it) const
+			{
+				if (this->snap != it.snap || this->index != it.index) return false;
+				return this->index == snap->maps.size() || this->pos == it.pos;
+			}
+			bool operator!=(const iterator & it) const { return !(*this == it); }
+		};
+
+		iterator begin() const { return iterator(this); }
+		iterator end() const { return iterator(this, /*end*/ true); }
+
+		s64 size() const
+		{
+			s64 count = 0;
+			for (s64 i = 0; i < maps.size(); ++i) count += maps[i].size();
+			return count;
+		}
+
+		bool contains(key_view key) const
+		{
+			u64 hash;
+			const map_type & map = map_of(key, hash);
+			return map.key_position(key, hash) != -1;
+		}
+
+		// safe usage: if (snap.contains(key)) value = snap.get(key);
+		Value get(key_view key) const
+		{
+			u64 hash;
+			const map_type & map = map_of(key, hash);
+			const s64 pos = map.key_position(key, hash);
+			if (pos == -1)
+				ERROR("ConcurrentHashMap: key is not in a snapshot, use snap.contains(key) to verify that key:value pair is in a snapshot");
+			return map.Values[pos];
+		}
+	};
+
+
+	// shards is rounded up to power of 2, more shards means less contention between threads
+	ConcurrentHashMap(u32 shards = DEFAULT_SHARDS): hasher(), seed(hash_seed())
+	{
+		if (shards == 0) ERROR("ConcurrentHashMap: amount of shards has to be positive");
+		shard_bits = shards == 1 ? 0 : 32 - count_leading_zeros(shards - 1);
+		if (shard_bits > 16) ERROR("ConcurrentHashMap: amount of shards can't exceed 2^16, given %u", shards);
+		Shards = new shard[(s64)1 << shard_bits];
+		// shards keep their cached hashes consistent with ones computed here
+		for (s64 i = 0; i < this->shards(); ++i) Shards[i].map.seed = seed;
+	}
+
+	// locks can't be copied or moved, snapshot() gives a copy of the data
+	ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+	ConcurrentHashMap & operator=(const ConcurrentHashMap &) = delete;
+
+	~ConcurrentHashMap() { delete[] Shards; }
+
+	inline s64 shards() const { return (s64)1 << shard_bits; }
+
+	// sum of all shard sizes, shards are counted one after another, so with concurrent writers it's approximate
+	s64 size() const
+	{
+		s64 count = 0;
+		for (s64 i = 0; i < shards(); ++i)
+		{
+			std::shared_lock<std::shared_mutex> guard(Shards[i].lock);
+			count += Shards[i].map.size();
+		}
+		return count;
+	}
+
+	inline bool isEmpty() const { return size() == 0; }
+
+	// inserts key:value pair, if key is already present its value is replaced
+	// returns true if key was inserted, false if it was present
+	bool insert_or_assign(key_view key, Value value)
+	{
+		const u64 hash = hash_key(key);
+		shard & s = Shards[shard_index(hash, shard_bits)];
+
+		std::unique_lock<std::shared_mutex> guard(s.lock);
+		s64 pos = s.map.key_position(key, hash);
+		if (pos != -1)
+		{
+			s.map.Values[pos] = std::move(value);
+			return false;
+		}
+		pos = s.map.claim_slot(key, hash);
+		new (s.map.Values + pos) Value(std::move(value));
+		return true;
+	}
+
+	// copies value associated with key into value, returns false (value left untouched) if key is not present
+	bool find(key_view key, Value & value) const
+	{
+		const u64 hash = hash_key(key);
+		const shard & s = Shards[shard_index(hash, shard_bits)];
+
+		std::shared_lock<std::shared_mutex> guard(s.lock);
+		const s64 pos = s.map.key_position(key, hash);
+		if (pos == -1) return false;
+		value = s.map.Values[pos];
+		return true;
+	}
+
+	bool contains(key_view key) const
+	{
+		const u64 hash = hash_key(key);
+		const shard & s = Shards[shard_index(hash, shard_bits)];
+
+		std::shared_lock<std::shared_mutex> guard(s.lock);
+		return s.map.key_position(key, hash) != -1;
+	}
+
+	// removes key and associated value, returns false if key is not present
+	bool erase(key_view key)
+	{
+		const u64 hash = hash_key(key);
+		shard & s = Shards[shard_index(hash, shard_bits)];
+
+		std::unique_lock<std::shared_mutex> guard(s.lock);
+		return s.map.key_remove(key, hash);
+	}
+
+	// returns copy of the whole map, which can be iterated and queried without any locking
+	snapshot_map snapshot() const
+	{
+		snapshot_map snap(shard_bits, hasher, seed);
+		snap.maps.reserve(shards());
+		for (s64 i = 0; i < shards(); ++i)
+		{
+			std::shared_lock<std::shared_mutex> guard(Shards[i].lock);
+			snap.maps.insert(Shards[i].map);
+		}
+		return snap;
+	}
+};
+
+
+#endif
@@ -0,0 +1,442 @@
+#ifndef _concurrentskiplistset_h
+#define _concurrentskiplistset_h
+
+#include <atomic> // atomic
+#include <cstdlib> // malloc, free
+#include <cstdint> // uintptr_t
+#include <new> // placement new
+#include <iterator> // iterator, input_iterator_tag
+#include "Array.h"
+#include "utility.h"
+
+
+// ordered set safe to use from multiple threads at once, lock free skip list
+// every value is linked into level 0 list and with probability 1/2^l into level l as well, so searches skip
+// most of the values on the way down, insert, contains and remove take O(log n) on average
+// nodes are linked by compare and swap, removal first marks node's links (lowest bit of the pointer), then unlinks it,
+// threads passing by unlink marked nodes they meet, so nothing ever waits for another thread
+// unlinked nodes are freed through epoch based reclamation, only after every thread has left the operations
+// that might have still seen them
+template <typename type, typename compareType = compare_to<type>>
+class ConcurrentSkipListSet
+{
+	// link to the next node, lowest bit set means the node owning the link is being removed
+	typedef std::atomic<uintptr_t> Link;
+
+	static const uintptr_t MARK = 1;
+	static const s32 MAX_LEVEL = 32;
+
+	struct Node
+	{
+		const type value;
+		s32 levels; // amount of links following the node
+		// inserting and removing thread both hold node, the last one to let it go retires it
+		std::atomic<s32> owners;
+
+		Node(const type & value, s32 levels): value(value), levels(levels), owners(2) { /* empty */ }
+	};
+
+	// links are placed right after the node in the same allocation
+	static const u64 LINKS_OFFSET = (sizeof(Node) + alignof(Link) - 1) / alignof(Link) * alignof(Link);
+
+	static Link* linksOf(Node* node) { return (Link*)((char*)node + LINKS_OFFSET); }
+	static Node* pointerOf(uintptr_t link) { return (Node*)(link & ~MARK); }
+	static bool isMarked(uintptr_t link) { return (link & MARK) != 0; }
+
+	// EPOCH BASED RECLAMATION
+	// thread announces the global epoch in a free slot for the duration of every operation
+	// global epoch moves on only once every active slot announces the current one, so a node retired in epoch e
+	// can't be reached by anyone once the global epoch is e + 2
+
+	// amount of threads (and live iterators) working with the set at once, more of them wait for a free slot
+	static const u32 SLOTS = 128;
+	// slot's retired nodes are looked through for those safe to free every RECLAIM_STEP retirements
+	static const s64 RECLAIM_STEP = 64;
+	static const u64 FREE_SLOT = 0;
+
+	struct retired_node
+	{
+		Node* node;
+		u64 epoch; // global epoch at the time node was retired
+	};
+
+	// aligned to cache line, so that announcements of different threads don't share one
+	struct alignas(64) slot
+	{
+		// FREE_SLOT, or (announced epoch << 1) | 1 while some thread holds the slot
+		std::atomic<u64> state;
+		// nodes retired by threads holding this slot, touched only by the current holder
+		Array<retired_node> retired;
+	};
+
+	Link head[MAX_LEVEL]; // links of the sentinel node preceding all values
+	std::atomic<u64> global_epoch;
+	slot* Slots;
+	compareType compare;
+	// written by every insert and remove, kept on a cache line of its own (last member, so nothing follows it)
+	alignas(64) std::atomic<s64> count;
+
+	// head is represented by nullptr
+	Link* linksOf(Node* node, s32 level) { return node == nullptr ? &head[level] : &linksOf(node)[level]; }
+
+	// every thread starts looking for a free slot at its own position, so threads rarely compete for one
+	static u32 homeSlot()
+	{
+		static std::atomic<u32> threads(0);
+		thread_local u32 home = threads.fetch_add(1) % SLOTS;
+		return home;
+	}
+
+	// claims a free slot with given state, returns slot's index
+	u32 claimSlot(u64 state)
+	{
+		u32 index = homeSlot();
+		u64 expected = FREE_SLOT;
+		while (!Slots[index].state.compare_exchange_weak(expected, state))
+		{
+			if (expected != FREE_SLOT) index = (index + 1) % SLOTS;
+			expected = FREE_SLOT;
+		}
+		return index;
+	}
+
+	// claims a free slot and announces current global epoch in it, returns slot's index
+	u32 enter()
+	{
+		u64 epoch = global_epoch.load();
+		u32 index = claimSlot((epoch << 1) | 1);
+		// global epoch might have moved on before the announcement became visible
+		for (u64 current = global_epoch.load(); current != epoch; current = global_epoch.load())
+		{
+			epoch = current;
+			Slots[index].state.store((epoch << 1) | 1);
+		}
+		return index;
+	}
+
+	void leave(u32 index) { Slots[index].state.store(FREE_SLOT); }
+
+	// holds a slot for the whole scope
+	class epoch_guard
+	{
+		friend class ConcurrentSkipListSet;
+
+		ConcurrentSkipListSet* set;
+		u32 index;
+
+	public:
+		epoch_guard(ConcurrentSkipListSet* set): set(set), index(set->enter()) { /* empty */ }
+		epoch_guard(const epoch_guard &) = delete;
+		epoch_guard & operator=(const epoch_guard &) = delete;
+		~epoch_guard() { set->leave(index); }
+	};
+
+	// moves global epoch on if every active slot announced the current one
+	void tryAdvanceEpoch()
+	{
+		u64 epoch = global_epoch.load();
+		for (u32 i = 0; i < SLOTS; ++i)
+		{
+			u64 state = Slots[i].state.load();
+			if (state != FREE_SLOT && (state >> 1) != epoch) return;
+		}
+		global_epoch.compare_exchange_strong(epoch, epoch + 1);
+	}
+
+	static void freeNode(Node* node)
+	{
+		for (s32 level = 0; level < node->levels; ++level) linksOf(node)[level].~Link();
+		node->~Node();
+		free(node);
+	}
+
+	// node can't be reached through the list anymore, it is freed once no thread can hold it
+	void retire(const epoch_guard & guard, Node* node)
+	{
+		Array<retired_node> & retired = Slots[guard.index].retired;
+		retired.insert({ node, global_epoch.load() });
+		if (retired.size() % RECLAIM_STEP != 0) return;
+
+		tryAdvanceEpoch();
+		u64 epoch = global_epoch.load();
+		s64 kept = 0;
+		for (s64 i = 0; i < retired.size(); ++i)
+		{
+			if (retired[i].epoch + 2 <= epoch) freeNode(retired[i].node);
+			else retired[kept++] = retired[i];
+		}
+		while (retired.size() > kept) retired.pop();
+	}
+
+	// lets node go, the last owner retires it
+	void release(const epoch_guard & guard, Node* node)
+	{
+		if (node->owners.fetch_sub(1) == 1) retire(guard, node);
+	}
+
+	// SKIP LIST
+
+	// random level, level l is taken with probability 1/2^(l+1)
+	static s32 randomLevels()
+	{
+		thread_local Random32 rng;
+		return (s32)count_trailing_zeros(rng.random() | (1u << (MAX_LEVEL - 1))) + 1;
+	}
+
+	// fills for every level last node smaller than value (preds) and the node after it (succs)
+	// unlinks every marked node met on the way, returns true if succs[0] holds value
+	bool find(const type & value, Node** preds, Node** succs)
+	{
+	retry:
+		Node* pred = nullptr;
+		for (s32 level = MAX_LEVEL - 1; level >= 0; --level)
+		{
+			Node* curr = pointerOf(linksOf(pred, level)->load(std::memory_order_acquire));
+			while (curr != nullptr)
+			{
+				uintptr_t succ = linksOf(curr)[level].load(std::memory_order_acquire);
+				if (isMarked(succ))
+				{
+					// curr is being removed, it is unlinked from pred at this level
+					uintptr_t expected = (uintptr_t)curr;
+					if (!linksOf(pred, level)->compare_exchange_strong(expected, succ & ~MARK, std::memory_order_acq_rel))
+						goto retry;
+					curr = pointerOf(succ);
+					continue;
+				}
+				if (compare(curr->value, value) >= 0) break;
+				pred = curr;
+				curr = pointerOf(succ);
+			}
+			preds[level] = pred;
+			succs[level] = curr;
+		}
+		return succs[0] != nullptr && compare(succs[0]->value, value) == 0;
+	}
+
+public:
+
+	// iterates through values in sorted order, values inserted or removed meanwhile may or may not be seen
+	// iterator holds an epoch slot while it points to a value, so nodes it points to aren't freed
+	class iterator : public std::iterator<std::input_iterator_tag, type>
+	{
+		friend class ConcurrentSkipListSet;
+
+		ConcurrentSkipListSet* set;
+		s64 index; // of held epoch slot, -1 if none is held
+		Node* pos;
+
+		// moves from link to the first value not being removed, end gives epoch slot back
+		void settle(uintptr_t link)
+		{
+			pos = pointerOf(link);
+			while (pos != nullptr && isMarked(linksOf(pos)[0].load(std::memory_order_acquire)))
+				pos = pointerOf(linksOf(pos)[0].load(std::memory_order_acquire));
+			if (pos == nullptr) leave();
+		}
+
+		void leave()
+		{
+			if (index != -1) set->leave((u32)index);
+			index = -1;
+		}
+
+	public:
+		// default non usable constructor, which returns invalid iterator
+		iterator(): set(nullptr), index(-1), pos(nullptr) { /* empty */ }
+
+		// end indicates to initialize end iterator
+		iterator(ConcurrentSkipListSet* set, bool end = false): set(set), index(-1), pos(nullptr)
+		{
+			if (end) return;
+			index = set->enter();
+			settle(set->head[0].load(std::memory_order_acquire));
+		}
+
+		// copy constructor, copy holds an epoch slot of its own announcing the same epoch as the original,
+		// so node pointed to stays protected after the original is gone
+		iterator(const iterator & it): set(it.set), index(-1), pos(it.pos)
+		{
+			if (it.index != -1) index = set->claimSlot(set->Slots[it.index].state.load());
+		}
+
+		// move constructor
+		iterator(iterator && it): set(it.set), index(it.index), pos(it.pos)
+		{
+			it.index = -1;
+			it.pos = nullptr;
+		}
+
+		// copy/move assignment utilizing copy/move constructor by taking argument as value
+		iterator & operator=(iterator it)
+		{
+			::swap(set, it.set);
+			::swap(index, it.index);
+			::swap(pos, it.pos);
+			return *this;
+		}
+
+		~iterator() { leave(); }
+
+		iterator & operator++()
+		{
+			settle(linksOf(pos)[0].load(std::memory_order_acquire));
+			return *this;
+		}
+
+		const type & operator*() const { return pos->value; }
+		const type* operator->() const { return &pos->value; }
+
+		bool operator==(const iterator & it) const { return this->set == it.set && this->pos == it.pos; }
+		bool operator!=(const iterator & it) const { return !(*this == it); }
+	};
+
+	// constructor
+	ConcurrentSkipListSet(): global_epoch(0), compare(), count(0)
+	{
+		for (s32 level = 0; level < MAX_LEVEL; ++level) head[level].store(0);
+		// new respects alignment of slot (C++17), malloc would give only 16 bytes
+		Slots = new slot[SLOTS];
+		for (u32 i = 0; i < SLOTS; ++i) Slots[i].state.store(FREE_SLOT);
+	}
+
+	// sharing a set between threads means sharing one instance
+	ConcurrentSkipListSet(const ConcurrentSkipListSet &) = delete;
+	ConcurrentSkipListSet & operator=(const ConcurrentSkipListSet &) = delete;
+
+	// no other thread may use the set anymore, everything still linked or retired is freed
+	~ConcurrentSkipListSet()
+	{
+		for (Node* node = pointerOf(head[0].load()); node != nullptr;)
+		{
+			Node* next = pointerOf(linksOf(node)[0].load());
+			freeNode(node);
+			node = next;
+		}
+		for (u32 i = 0; i < SLOTS; ++i)
+			for (s64 j = 0; j < Slots[i].retired.size(); ++j) freeNode(Slots[i].retired[j].node);
+		delete[] Slots;
+	}
+
+	// returns true if value was not present in container, false otherwhise
+	bool insert(const type & value)
+	{
+		epoch_guard guard(this);
+		Node* preds[MAX_LEVEL];
+		Node* succs[MAX_LEVEL];
+		Node* node = nullptr;
+		while (true)
+		{
+			if (find(value, preds, succs))
+			{
+				if (node != nullptr) freeNode(node);
+				return false;
+			}
+			if (node == nullptr)
+			{
+				s32 levels = randomLevels();
+				node = new (malloc(LINKS_OFFSET + levels * sizeof(Link))) Node(value, levels);
+				for (s32 level = 0; level < levels; ++level) new (&linksOf(node)[level]) Link();
+			}
+			for (s32 level = 0; level < node->levels; ++level)
+				linksOf(node)[level].store((uintptr_t)succs[level], std::memory_order_relaxed);
+
+			// linking into level 0 inserts value, upper levels only speed up searches
+			uintptr_t expected = (uintptr_t)succs[0];
+			if (linksOf(preds[0], 0)->compare_exchange_strong(expected, (uintptr_t)node, std::memory_order_acq_rel)) break;
+		}
+		count.fetch_add(1);
+
+		for (s32 level = 1; level < node->levels; ++level)
+		{
+			while (true)
+			{
+				// node's link is pointed to the current successor unless removal already marked it
+				uintptr_t own = linksOf(node)[level].load(std::memory_order_acquire);
+				if (isMarked(own)) goto built;
+				if (own != (uintptr_t)succs[level] &&
+					!linksOf(node)[level].compare_exchange_strong(own, (uintptr_t)succs[level], std::memory_order_acq_rel))
+					continue;
+
+				uintptr_t expected = (uintptr_t)succs[level];
+				if (linksOf(preds[level], level)->compare_exchange_strong(expected, (uintptr_t)node, std::memory_order_acq_rel))
+					break;
+				// list changed around node, its neighbours are looked up again, node itself may be removed meanwhile
+				find(value, preds, succs);
+				if (succs[0] != node) goto built;
+			}
+		}
+	built:
+		// node removed while upper levels were being linked may have been linked after remover unlinked it
+		if (isMarked(linksOf(node)[0].load(std::memory_order_acquire))) find(value, preds, succs);
+		release(guard, node);
+		return true;
+	}
+
+	bool contains(const type & value)
+	{
+		epoch_guard guard(this);
+		Node* pred = nullptr;
+		Node* curr = nullptr;
+		for (s32 level = MAX_LEVEL - 1; level >= 0; --level)
+		{
+			curr = pointerOf(linksOf(pred, level)->load(std::memory_order_acquire));
+			while (curr != nullptr && compare(curr->value, value) < 0)
+			{
+				pred = curr;
+				curr = pointerOf(linksOf(curr)[level].load(std::memory_order_acquire));
+			}
+		}
+		// node being removed can still be followed by the same value inserted again
+		while (curr != nullptr && compare(curr->value, value) == 0)
+		{
+			uintptr_t next = linksOf(curr)[0].load(std::memory_order_acquire);
+			if (!isMarked(next)) return true;
+			curr = pointerOf(next);
+		}
+		return false;
+	}
+
+	// returns true if value was removed by this call, false if it wasn't present
+	bool remove(const type & value)
+	{
+		epoch_guard guard(this);
+		Node* preds[MAX_LEVEL];
+		Node* succs[MAX_LEVEL];
+		while (true)
+		{
+			if (!find(value, preds, succs)) return false;
+			Node* node = succs[0];
+
+			// upper links are marked first, so nothing is linked behind node while it is being removed
+			for (s32 level = node->levels - 1; level >= 1; --level)
+			{
+				uintptr_t link = linksOf(node)[level].load(std::memory_order_acquire);
+				while (!isMarked(link))
+					linksOf(node)[level].compare_exchange_weak(link, link | MARK, std::memory_order_acq_rel);
+			}
+			// marking level 0 removes value, only one thread succeeds, others look for value again
+			uintptr_t link = linksOf(node)[0].load(std::memory_order_acquire);
+			while (!isMarked(link))
+			{
+				if (linksOf(node)[0].compare_exchange_weak(link, link | MARK, std::memory_order_acq_rel))
+				{
+					count.fetch_sub(1);
+					// unlinks node from every level
+					find(value, preds, succs);
+					release(guard, node);
+					return true;
+				}
+			}
+		}
+	}
+
+	// amount of values, changes done by other threads meanwhile may or may not be counted
+	s64 size() const { return count.load(); }
+	bool isEmpty() const { return size() == 0; }
+	iterator begin() { return iterator(this); }
+	iterator end() { return iterator(this, /*end*/ true); }
+};
+
+
+#endif
@@ -1,149 +1,1017 @@
 #ifndef _hashmap_h
 #define _hashmap_h
 
+#include <cstdlib> // malloc, free
+#include <cstring> // memcpy, memcmp, memset, strlen
+#include <type_traits> // is_integral, is_enum, is_pointer, is_trivially_copyable
+#if defined(_WIN32)
+// included before utility.h, which redefines windows' ERROR macro
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h> // CreateFileMapping, MapViewOfFile
+#else
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close
+#endif
+#include "Array.h"
 #include "utility.h"
 
-template <typename type>
-class HashMap
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HASHMAP_SSE2
+#include <emmintrin.h> // SSE2 intrinsics used to match 16 control bytes at once
+#endif
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define HASHMAP_STRING_VIEW
+#include <string_view> // string keys can be looked up by string_view
+#endif
+
+
+// every slot has a control byte: full slot stores lower 7 bits of key's hash (0..127)
+// empty and deleted slots are negative, so both are found by the sign bit alone
+static const s8 CTRL_EMPTY = -128;
+static const s8 CTRL_DELETED = -2;
+// amount of control bytes matched at once
+static const s64 GROUP_WIDTH = 16;
+
+
+// group of GROUP_WIDTH consecutive control bytes
+// every match returns a bitmask, where bit i stands for slot (group position + i)
+struct ctrl_group
 {
-	struct key_entry
+#ifdef HASHMAP_SSE2
+	__m128i ctrl;
+
+	explicit ctrl_group(const s8* pos): ctrl(_mm_loadu_si128((const __m128i*)pos)) { /* empty */ }
+
+	u32 match(s8 tag) const { return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl)); }
+	u32 match_empty() const { return match(CTRL_EMPTY); }
+	u32 match_empty_or_deleted() const { return (u32)_mm_movemask_epi8(ctrl); }
+#else
+	const s8* ctrl;
+
+	explicit ctrl_group(const s8* pos): ctrl(pos) { /* empty */ }
+
+	u32 match(s8 tag) const
+	{
+		u32 mask = 0;
+		for (s64 i = 0; i < GROUP_WIDTH; ++i)
+			if (ctrl[i] == tag) mask |= 1u << i;
+		return mask;
+	}
+
+	u32 match_empty() const { return match(CTRL_EMPTY); }
+
+	u32 match_empty_or_deleted() const
+	{
+		u32 mask = 0;
+		for (s64 i = 0; i < GROUP_WIDTH; ++i)
+			if (ctrl[i] < 0) mask |= 1u << i;
+		return mask;
+	}
+#endif
+};
+
+
+// finalizer of MurmurHash3, spreads every bit of the key over the whole 64 bit result
+inline static u64 hash_mix(u64 key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+// full 128 bit product of a and b folded into 64 bits
+inline static u64 hash_multiply(u64 a, u64 b)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	u64 high;
+	const u64 low = _umul128(a, b, &high);
+	return low ^ high;
+#elif defined(__SIZEOF_INT128__)
+	const unsigned __int128 product = (unsigned __int128)a * b;
+	return (u64)product ^ (u64)(product >> 64);
+#else
+	// schoolbook multiplication of 32 bit halves
+	const u64 a_low = (u32)a, a_high = a >> 32, b_low = (u32)b, b_high = b >> 32;
+	const u64 low_low = a_low * b_low, low_high = a_low * b_high, high_low = a_high * b_low, high_high = a_high * b_high;
+	const u64 middle = (low_low >> 32) + (u32)low_high + (u32)high_low;
+	const u64 low = (middle << 32) | (u32)low_low;
+	const u64 high = high_high + (low_high >> 32) + (high_low >> 32) + (middle >> 32);
+	return low ^ high;
+#endif
+}
+
+// unaligned little endian reads
+inline static u64 hash_read64(const u8* bytes) { u64 word; memcpy(&word, bytes, sizeof(word)); return word; }
+inline static u64 hash_read32(const u8* bytes) { u32 word; memcpy(&word, bytes, sizeof(word)); return word; }
+
+// wyhash style hash of raw bytes, consumes 8 bytes at a time, 48 per iteration for long keys
+// keys up to 16 bytes are read by (possibly overlapping) words without any loop
+inline static u64 hash_bytes(const void* data, u64 length, u64 seed)
+{
+	const u64 P0 = 0xa0761d6478bd642fULL, P1 = 0xe7037ed1a0b428dbULL, P2 = 0x8ebc6af09c88c6e3ULL, P3 = 0x589965cc75374cc3ULL;
+	const u8* bytes = (const u8*)data;
+	seed ^= hash_multiply(seed ^ P0, P1);
+
+	u64 a, b;
+	if (length <= 16)
+	{
+		if (length >= 4)
+		{
+			const u64 middle = (length >> 3) << 2; // 0 for up to 7 bytes, 4 for 8 and more
+			a = (hash_read32(bytes) << 32) | hash_read32(bytes + middle);
+			b = (hash_read32(bytes + length - 4) << 32) | hash_read32(bytes + length - 4 - middle);
+		}
+		else if (length > 0)
+		{
+			a = ((u64)bytes[0] << 16) | ((u64)bytes[length >> 1] << 8) | bytes[length - 1];
+			b = 0;
+		}
+		else a = b = 0;
+	}
+	else
+	{
+		u64 left = length;
+		if (left > 48)
+		{
+			// three independent lanes, so that multiplications don't wait for each other
+			u64 seed1 = seed, seed2 = seed;
+			do
+			{
+				seed = hash_multiply(hash_read64(bytes) ^ P1, hash_read64(bytes + 8) ^ seed);
+				seed1 = hash_multiply(hash_read64(bytes + 16) ^ P2, hash_read64(bytes + 24) ^ seed1);
+				seed2 = hash_multiply(hash_read64(bytes + 32) ^ P3, hash_read64(bytes + 40) ^ seed2);
+				bytes += 48;
+				left -= 48;
+			} while (left > 48);
+			seed ^= seed1 ^ seed2;
+		}
+		while (left > 16)
+		{
+			seed = hash_multiply(hash_read64(bytes) ^ P1, hash_read64(bytes + 8) ^ seed);
+			bytes += 16;
+			left -= 16;
+		}
+		// last 16 bytes, overlapping already consumed ones if needed
+		a = hash_read64(bytes + left - 16);
+		b = hash_read64(bytes + left - 8);
+	}
+	return hash_multiply(hash_multiply(a ^ P1, b ^ seed) ^ P0 ^ length, P1);
+}
+
+
+// default hash policy, seed is chosen per map, so that hash order differs between maps and runs
+// integral, enum and pointer keys are mixed directly
+// any other key is hashed by its raw bytes, so keys with padding or pointers to data need their own policy
+// custom policy only has to provide the same call operator (key, seed) or (key, length, seed) for c strings
+template <typename Key>
+struct hash_of
+{
+	u64 operator()(const Key & key, u64 seed) const
+	{
+		return hash(key, seed, std::integral_constant<bool, std::is_integral<Key>::value ||
+			std::is_enum<Key>::value || std::is_pointer<Key>::value>());
+	}
+
+private:
+	static u64 hash(const Key & key, u64 seed, std::true_type) { return hash_mix((u64)key ^ seed); }
+	static u64 hash(const Key & key, u64 seed, std::false_type) { return hash_bytes(&key, sizeof(Key), seed); }
+};
+
+// c string keys are hashed by their content
+template <>
+struct hash_of<const char*>
+{
+	u64 operator()(const char* key, u64 length, u64 seed) const { return hash_bytes(key, length, seed); }
+};
+
+// returns random seed for a new map, each thread has its own generator
+inline static u64 hash_seed()
+{
+	thread_local Random64 generator;
+	return generator.random();
+}
+
+
+// default equality policy
+template <typename Key>
+struct key_equal
+{
+	bool operator()(const Key & lhs, const Key & rhs) const { return lhs == rhs; }
+};
+
+// c string keys are equal if their content is equal
+template <>
+struct key_equal<const char*>
+{
+	bool operator()(const char* lhs, u64 lhs_length, const char* rhs, u64 rhs_length) const
+		{ return lhs_length == rhs_length && memcmp(lhs, rhs, lhs_length) == 0; }
+};
+
+
+// append only storage for c string keys too long to be stored inline within a slot
+// keys are referenced by offset, so growing the arena doesn't invalidate them
+struct key_arena
+{
+	char* data;
+	u64 size; // used bytes
+	u64 capacity; // allocated bytes
+	u64 garbage; // bytes taken by removed keys, reclaimed when map rebuilds arena on resize or compaction
+
+	// will double every time reaches limit
+	static const u64 INITIAL_CAPACITY = 1024;
+
+	key_arena(): data(nullptr), size(0), capacity(0), garbage(0) { /* empty */ }
+
+	// copy constructor
+	key_arena(const key_arena & arena): data(nullptr), size(arena.size), capacity(arena.size), garbage(arena.garbage)
+	{
+		if (size == 0) return;
+		data = (char*)malloc(sizeof(char) * size);
+		if (data == nullptr) ERROR("HashMap: failed to allocate memory to copy key arena");
+		memcpy(data, arena.data, size);
+	}
+
+	// move constructor
+	key_arena(key_arena && arena): data(arena.data), size(arena.size), capacity(arena.capacity), garbage(arena.garbage)
+	{
+		arena.data = nullptr;
+		arena.size = arena.capacity = arena.garbage = 0;
+	}
+
+	// copy/move assignment utilizing copy/move constructor by taking argument as value
+	key_arena & operator=(key_arena arena)
+	{
+		swap(data, arena.data);
+		swap(size, arena.size);
+		swap(capacity, arena.capacity);
+		swap(garbage, arena.garbage);
+		return *this;
+	}
+
+	~key_arena() { free(data); }
+
+	// copies key with terminating \0 to the end of arena and returns its offset
+	u64 append(const char* key, u64 length)
+	{
+		if (size + length + 1 > capacity)
+		{
+			u64 new_capacity = capacity == 0 ? INITIAL_CAPACITY : capacity * 2;
+			while (new_capacity < size + length + 1) new_capacity *= 2;
+			char* new_data = (char*)realloc(data, sizeof(char) * new_capacity);
+			if (new_data == nullptr) ERROR("HashMap: failed to allocate memory to expand key arena");
+			data = new_data;
+			capacity = new_capacity;
+		}
+		const u64 offset = size;
+		memcpy(data + offset, key, length);
+		data[offset + length] = '\0';
+		size += length + 1;
+		return offset;
+	}
+};
+
+
+// describes how a key is stored within a slot and how lookups look at it
+// view is what probing works with: key itself for ordinary keys, pointer and length for c strings
+// arena is map owned storage for key data that doesn't fit into a slot
+template <typename Key>
+struct key_traits
+{
+	typedef Key stored;
+	typedef const Key & view;
+	typedef const Key & reference;
+
+	// ordinary keys are stored within slots themselves
+	struct arena { };
+
+	// arena access for saving and mapping snapshots
+	static const char* arena_data(const arena &) { return nullptr; }
+	static u64 arena_size(const arena &) { return 0; }
+	static bool arena_wasteful(const arena &, s64) { return false; }
+	static void arena_borrow(arena &, char*, u64) { /* empty */ }
+	static void arena_release(arena &) { /* empty */ }
+
+	static view get_view(const stored & slot, const arena &) { return slot; }
+	static reference get(const stored & slot, const arena &) { return slot; }
+
+	template <typename Hash>
+	static u64 hash(const Hash & hasher, view key, u64 seed) { return hasher(key, seed); }
+	template <typename Eq>
+	static bool equal(const Eq & eq, const stored & slot, view key, const arena &) { return eq(slot, key); }
+
+	static void construct(stored* slot, view key, arena &) { new (slot) Key(key); }
+	static void destroy(stored & slot, arena &) { slot.~Key(); }
+	// moves key from one slot to another within the same map, leaving from slot destructed
+	static void move(stored* to, stored & from)
 	{
-		char* key;
+		new (to) Key(std::move(from));
+		from.~Key();
+	}
+	// moves key into a slot of a map with another arena, leaving from slot destructed
+	static void relocate(stored* to, stored & from, const arena &, arena &) { move(to, from); }
+};
+
+// c string keys are copied into map owned memory, key length can't exceed 2^16 - 1
+// short keys are stored inline within a slot, longer ones are appended to map's key arena
+template <>
+struct key_traits<const char*>
+{
+	static const u64 INLINE_LENGTH = 15; // + \0 fills 16 bytes
+
+	struct stored
+	{
+		union
+		{
+			char text[INLINE_LENGTH + 1]; // inline key, if length <= INLINE_LENGTH
+			u64 offset; // position within key arena otherwise
+		};
 		u16 length;
+	};
+
+	// lookups accept c string, pointer and length or string_view
+	struct view
+	{
+		const char* key;
+		u64 length;
+
+		view(const char* key): key(key), length(strlen(key)) { /* empty */ }
+		view(const char* key, u64 length): key(key), length(length) { /* empty */ }
+#ifdef HASHMAP_STRING_VIEW
+		view(std::string_view key): key(key.data()), length(key.size()) { /* empty */ }
+#endif
+	};
+
+	typedef const char* reference;
+	typedef key_arena arena;
+
+	static bool is_inline(const stored & slot) { return slot.length <= INLINE_LENGTH; }
+
+	// arena access for saving and mapping snapshots
+	// borrowed arena reads keys from memory it doesn't own, it has to be released before it's destructed
+	static const char* arena_data(const arena & keys) { return keys.data; }
+	static u64 arena_size(const arena & keys) { return keys.size; }
+	// removed keys outweigh live ones, and also slots of the table, as compaction rehashes all of them
+	static bool arena_wasteful(const arena & keys, s64 slots) { return keys.garbage * 2 > keys.size && keys.garbage > (u64)slots * sizeof(stored); }
+	static void arena_borrow(arena & keys, char* data, u64 size)
+	{
+		keys = arena();
+		keys.data = data;
+		keys.size = keys.capacity = size;
+	}
+	static void arena_release(arena & keys) { keys.data = nullptr; keys.size = keys.capacity = keys.garbage = 0; }
+
+	static view get_view(const stored & slot, const arena & keys) { return view(get(slot, keys), slot.length); }
+	static reference get(const stored & slot, const arena & keys) { return is_inline(slot) ? slot.text : keys.data + slot.offset; }
+
+	template <typename Hash>
+	static u64 hash(const Hash & hasher, view key, u64 seed) { return hasher(key.key, key.length, seed); }
+	template <typename Eq>
+	static bool equal(const Eq & eq, const stored & slot, view key, const arena & keys)
+		{ return eq(get(slot, keys), slot.length, key.key, key.length); }
+
+	static void construct(stored* slot, view key, arena & keys)
+	{
+		if (key.length > UINT16_MAX)
+			ERROR("HashMap: key length can't exceed 2^16 - 1, given key length %llu", key.length);
+		slot->length = (u16)key.length;
+		if (key.length <= INLINE_LENGTH)
+		{
+			memcpy(slot->text, key.key, key.length);
+			slot->text[key.length] = '\0';
+		}
+		else slot->offset = keys.append(key.key, key.length);
+	}
+
+	static void destroy(stored & slot, arena & keys)
+	{
+		if (!is_inline(slot)) keys.garbage += slot.length + 1;
+	}
 
-		key_entry(): key(nullptr), length(0) { /* empty */ }
+	// key data stays in the same arena, so only the slot is copied
+	static void move(stored* to, stored & from) { *to = from; }
 
-		key_entry(const char* key, u16 length)
+	// long keys are copied into to_arena, which compacts them leaving out removed ones
+	static void relocate(stored* to, stored & from, const arena & from_keys, arena & to_keys)
+	{
+		*to = from;
+		if (!is_inline(from)) to->offset = to_keys.append(from_keys.data + from.offset, from.length);
+	}
+};
+
+
+// whole file mapped into memory, pages are copy on write:
+// writing to them changes only this process' memory, never the file
+struct file_mapping
+{
+	void* data;
+	u64 size;
+
+	file_mapping(): data(nullptr), size(0) { /* empty */ }
+
+	// move constructor
+	file_mapping(file_mapping && mapping): data(mapping.data), size(mapping.size)
+	{
+		mapping.data = nullptr;
+		mapping.size = 0;
+	}
+
+	// move assignment
+	file_mapping & operator=(file_mapping && mapping)
+	{
+		swap(data, mapping.data);
+		swap(size, mapping.size);
+		return *this;
+	}
+
+	~file_mapping() { close(); }
+
+	bool is_open() const { return data != nullptr; }
+
+	// maps whole file, returns false if it can't be opened, is empty or mapping fails
+	bool open(const char* filename)
+	{
+		close();
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (mapping == nullptr) return false;
+		// view keeps the mapping alive after its handle is closed
+		void* address = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(mapping);
+		if (address == nullptr) return false;
+		size = (u64)file_size.QuadPart;
+#else
+		int file = ::open(filename, O_RDONLY);
+		if (file == -1) return false;
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size == 0)
 		{
-			this->key = (char*)malloc(sizeof(char) * (length + 1)); // +1 for \0
-			strncpy_s(this->key, (size_t)(length+1), key, (size_t)length);
-			this->length = length;
+			::close(file);
+			return false;
 		}
+		// mapping stays valid after the file is closed
+		void* address = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		::close(file);
+		if (address == MAP_FAILED) return false;
+		size = (u64)info.st_size;
+#endif
+		data = address;
+		return true;
+	}
+
+	void close()
+	{
+		if (data == nullptr) return;
+#if defined(_WIN32)
+		UnmapViewOfFile(data);
+#else
+		munmap(data, (size_t)size);
+#endif
+		data = nullptr;
+		size = 0;
+	}
+};
+
+
+// first bytes of a HashMap snapshot file, followed by control bytes, key entries, values and key arena
+// every section starts at a multiple of SNAPSHOT_ALIGNMENT bytes from the beginning of the file
+struct snapshot_header
+{
+	u64 magic;
+	u64 version;
+	// sizes of the map's types, snapshot can only be opened by a map of the same types
+	u64 key_entry_size;
+	u64 value_size;
+	u64 group_width;
+
+	s64 capacity;
+	s64 count;
+	s64 deleted;
+	u64 seed; // keys' cached hashes are stored, so map has to keep hashing with the same seed
+	u64 arena_size;
+
+	u64 controls_offset;
+	u64 keys_offset;
+	u64 values_offset;
+	u64 arena_offset;
+	u64 file_size;
+};
+
+static const u64 SNAPSHOT_MAGIC = 0x3150414d48534148ULL; // "HASHMAP1" read as little endian u64
+static const u64 SNAPSHOT_VERSION = 2;
+static const u64 SNAPSHOT_ALIGNMENT = 64;
+
+
+template <typename Key, typename Value, typename Hash, typename Eq>
+class ConcurrentHashMap;
+
+
+// open addressing hash map
+// slots are probed a group of GROUP_WIDTH control bytes at a time (SSE2 when available)
+// full 64 bit hash of every key is cached, so resize never rehashes and most mismatches are rejected without comparing keys
+template <typename Key, typename Value, typename Hash = hash_of<Key>, typename Eq = key_equal<Key>>
+class HashMap
+{
+	// shards of concurrent map are probed with hashes it has computed already
+	friend class ConcurrentHashMap<Key, Value, Hash, Eq>;
+
+	typedef key_traits<Key> traits;
+
+public:
+
+	// what lookups take: const Key & for ordinary keys
+	// for c string keys it's constructed from c string, pointer and length or string_view, which avoids strlen
+	typedef typename traits::view key_view;
+
+	// key paired with its hash, for callers which already know it
+	// hash has to be the one returned by map.hash(key)
+	struct hashed_key
+	{
+		u64 hash;
+		key_view key;
+
+		hashed_key(u64 hash, key_view key): hash(hash), key(key) { /* empty */ }
 	};
 
+	// result of try_emplace: value associated with the key and whether it was just inserted
+	struct emplace_result
+	{
+		Value* value;
+		bool inserted;
+	};
+
+private:
+
+	struct key_entry
+	{
+		u64 hash;
+		typename traits::stored key;
+	};
+
+	// capacity + GROUP_WIDTH control bytes, the last GROUP_WIDTH mirror the first ones
+	// so that a group starting near the end can be loaded without wrapping around
+	s8* Controls;
 	key_entry* Keys;
-	type* Values;
+	Value* Values;
 
-	s64 capacity; // allocated size
+	s64 capacity; // allocated size, always power of 2
 	s64 count; // effective size
+	s64 deleted; // amount of slots marked as deleted
+
+	typename traits::arena arena;
+
+	// random per map, cached hashes are only valid with the seed they were computed with
+	u64 seed;
+
+	// table left behind by incremental resize, its entries move into current table a few groups per operation
+	// count includes its entries, Controls is nullptr when no resize is in progress
+	struct retired_table
+	{
+		s8* Controls;
+		key_entry* Keys;
+		Value* Values;
+		s64 capacity;
+		s64 count; // entries not yet moved
+		s64 migrated; // slots before this position are already moved
+		typename traits::arena arena;
+
+		retired_table(): Controls(nullptr), Keys(nullptr), Values(nullptr), capacity(0), count(0), migrated(0), arena() { /* empty */ }
+	};
+	retired_table retired;
+	// resize only starts a migration instead of moving all entries at once, see set_incremental_resize
+	bool incremental;
+
+	// map opened from a snapshot reads all arrays directly from the mapped file
+	// it's copied into map owned memory before its first structural change (detach)
+	file_mapping mapping;
+
+	Hash hasher;
+	Eq equal;
 
 	// will double every time reaches limit
-	static const u16 INITIAL_CAPACITY = 64;
+	static const s64 INITIAL_CAPACITY = 64;
+	// amount of keys hashed and prefetched ahead of probing by batched operations
+	static const s64 BATCH_SIZE = 16;
+	// amount of retired table slots moved by each operation during incremental resize
+	// table is at most 7/8 full when it's retired and the new one fills up no sooner than after capacity * 7/8
+	// insertions, so even 2 slots per operation would finish migration before the next resize is needed
+	static const s64 MIGRATION_STEP = 4 * GROUP_WIDTH;
+
+	// upper bits of the hash choose starting position, lower 7 bits are stored in control byte
+	static u64 h1(u64 hash) { return hash >> 7; }
+	static s8 h2(u64 hash) { return (s8)(hash & 0x7F); }
 
+	// capacity is power of 2, so masking replaces modulo
+	inline s64 wrap(s64 pos) const { return pos & (capacity - 1); }
+	inline s64 home(u64 hash) const { return (s64)(h1(hash) & (u64)(capacity - 1)); }
+
+	// max load factor is 7/8, returns true if one more slot can't be occupied without breaking it
+	bool is_overloaded() const { return (count + deleted + 1) * 8 > capacity * 7; }
+
+	// allocates arrays for given capacity with all slots empty
+	void allocate(s64 size)
+	{
+		const s64 entry_size = sizeof(key_entry) + sizeof(Value) + sizeof(s8);
+		if ((size * entry_size) / size != entry_size)
+			ERROR("HashMap: allocation failed, given size(%lld) * entry_size(%lld) overflows", size, entry_size);
+
+		Controls = (s8*)malloc(sizeof(s8) * (size + GROUP_WIDTH));
+		Keys = (key_entry*)malloc(sizeof(key_entry) * size);
+		Values = (Value*)malloc(sizeof(Value) * size);
+		if (Controls == nullptr || Keys == nullptr || Values == nullptr)
+			ERROR("HashMap: failed to allocate memory for %lld entries", size);
+		memset(Controls, CTRL_EMPTY, size + GROUP_WIDTH);
+
+		capacity = size;
+		count = 0;
+		deleted = 0;
+	}
 
-	u64 hashCode(const char* key, u16 length)
+	void set_ctrl(s64 pos, s8 ctrl)
 	{
-		u64 hash = 5381;
-		const u64 MULTIPLIER = 33;
-		for (s64 i = 0; i < length; ++i)
-			hash = hash * MULTIPLIER + key[i];
-		return hash;
+		Controls[pos] = ctrl;
+		if (pos < GROUP_WIDTH) Controls[capacity + pos] = ctrl;
 	}
 
-	inline u16 key_length(const char* key)
+	// moves probing to the next group
+	inline s64 next_group(s64 pos) const
 	{
-		u16 length = 0;
-		while (key[length] != '\0') ++length;
-		return length;
+		return wrap(pos + GROUP_WIDTH);
 	}
 
-	// returns key position in Keys array, -1 if key is not present
-	s64 key_position(const char* key)
+	// returns key position in given table's Keys array, -1 if key is not present
+	s64 table_position(const s8* controls, const key_entry* keys, s64 size,
+		const typename traits::arena & keys_arena, key_view key, u64 hash) const
 	{
-		u16 length = key_length(key);
-		u64 pos = hashCode(key, length) % (u64)capacity;
+		const s8 tag = h2(hash);
+		const s64 mask = size - 1;
+		s64 pos = (s64)(h1(hash) & (u64)mask);
 
 		while (true)
 		{
-			if (Keys[pos].key == nullptr) return -1;
-			if (strncmp(Keys[pos].key, key, length) == 0) return (s64)pos;
-			pos = (pos + 1) % (u64)capacity;
+			ctrl_group group(controls + pos);
+			for (u32 matches = group.match(tag); matches != 0; matches &= matches - 1)
+			{
+				const s64 candidate = (pos + count_trailing_zeros(matches)) & mask;
+				if (keys[candidate].hash == hash && traits::equal(equal, keys[candidate].key, key, keys_arena))
+					return candidate;
+			}
+			// key would have been placed into the first empty slot on its probe sequence
+			if (group.match_empty() != 0) return -1;
+			pos = (pos + GROUP_WIDTH) & mask;
 		}
 	}
 
-	// inserts key and associated value and returns insertion position
-	s64 key_insert(const char* key, type value)
+	// returns key position in Keys array, -1 if key is not present in current table
+	s64 key_position(key_view key, u64 hash) const { return table_position(Controls, Keys, capacity, arena, key, hash); }
+
+	// returns key position in retired table, -1 if key is not present there or there is no retired table
+	s64 retired_position(key_view key, u64 hash) const
+	{
+		if (retired.Controls == nullptr) return -1;
+		return table_position(retired.Controls, retired.Keys, retired.capacity, retired.arena, key, hash);
+	}
+
+	// returns pointer to value associated with key in either table, nullptr if key is not present
+	// doesn't move anything, so it's usable by const lookups
+	const Value* value_of(key_view key, u64 hash) const
 	{
-		if (count * 2 >= capacity) resize(capacity * 2);
+		s64 pos = key_position(key, hash);
+		if (pos != -1) return Values + pos;
+		pos = retired_position(key, hash);
+		return pos == -1 ? nullptr : retired.Values + pos;
+	}
 
-		u16 length = key_length(key);
-		u64 pos = hashCode(key, length) % (u64)capacity;
+	// returns key position in current table, -1 if key is not present
+	// advances incremental resize, key found in retired table is moved into current one first
+	s64 settled_position(key_view key, u64 hash)
+	{
+		migrate_step();
+		s64 pos = key_position(key, hash);
+		if (pos != -1 || retired.Controls == nullptr) return pos;
+		pos = retired_position(key, hash);
+		return pos == -1 ? -1 : migrate_entry(pos);
+	}
 
+	// returns first empty or deleted slot on hash's probe sequence
+	s64 free_position(u64 hash) const
+	{
+		s64 pos = home(hash);
 		while (true)
 		{
-			if (Keys[pos].key == nullptr)
-			{
-				Keys[pos]   = key_entry(key, length);
-				new (Values + pos) type(std::move(value));
-				++count; break;
-			}
-			if (strncmp(Keys[pos].key, key, length) == 0)
+			u32 mask = ctrl_group(Controls + pos).match_empty_or_deleted();
+			if (mask != 0)
 			{
-				Values[pos] = std::move(value); break;
+				return wrap(pos + count_trailing_zeros(mask));
 			}
-			pos = (pos + 1) % (u64)capacity;
+			pos = next_group(pos);
+		}
+	}
+
+	// occupies a slot for a key, which is not present in a map, and returns its position
+	// key is constructed, value at returned position is left for the caller to construct
+	s64 claim_slot(key_view key, u64 hash)
+	{
+		detach();
+		s64 pos = free_position(hash);
+		// reusing deleted slot doesn't increase amount of occupied slots
+		if (Controls[pos] == CTRL_EMPTY && is_overloaded())
+		{
+			grow();
+			pos = free_position(hash);
+		}
+		if (Controls[pos] == CTRL_DELETED) --deleted;
+
+		set_ctrl(pos, h2(hash));
+		Keys[pos].hash = hash;
+		traits::construct(&Keys[pos].key, key, arena);
+		++count;
+		return pos;
+	}
+
+	// inserts key and associated value and returns insertion position
+	s64 key_insert(key_view key, u64 hash, Value && value)
+	{
+		s64 pos = settled_position(key, hash);
+		if (pos != -1)
+		{
+			Values[pos] = std::move(value);
+			return pos;
 		}
+		pos = claim_slot(key, hash);
+		new (Values + pos) Value(std::move(value));
 		return pos;
 	}
 
+	// doubles capacity if at least half of max load is occupied by live entries
+	// otherwise most of the load are deleted slots, so rehashing into the same capacity is enough
+	void grow()
+	{
+		const s64 new_size = count * 16 >= capacity * 7 ? capacity * 2 : capacity;
+		if (incremental) start_resize(new_size);
+		else resize(new_size);
+	}
+
+	// moves retired table's entry at given position into current table and returns its new position
+	s64 migrate_entry(s64 pos)
+	{
+		const u64 hash = retired.Keys[pos].hash;
+		const s64 new_pos = free_position(hash);
+		if (Controls[new_pos] == CTRL_DELETED) --deleted;
+		set_ctrl(new_pos, h2(hash));
+		Keys[new_pos].hash = hash;
+		traits::relocate(&Keys[new_pos].key, retired.Keys[pos].key, retired.arena, arena);
+		new (Values + new_pos) Value(std::move(retired.Values[pos])); retired.Values[pos].~Value();
+
+		// slot stays occupied for probing, so keys further along its probe sequence can still be found
+		retired.Controls[pos] = CTRL_DELETED;
+		if (pos < GROUP_WIDTH) retired.Controls[retired.capacity + pos] = CTRL_DELETED;
+		--retired.count;
+		return new_pos;
+	}
+
+	// moves next MIGRATION_STEP slots of retired table, frees it once all entries are moved
+	void migrate_step()
+	{
+		if (retired.Controls == nullptr) return;
+		const s64 end = retired.migrated + MIGRATION_STEP < retired.capacity ? retired.migrated + MIGRATION_STEP : retired.capacity;
+		for (s64 pos = retired.migrated; pos < end && retired.count > 0; ++pos)
+			if (retired.Controls[pos] >= 0) migrate_entry(pos);
+		retired.migrated = end;
+		if (retired.count == 0) release_retired();
+	}
+
+	// moves all entries left in retired table
+	void finish_migration()
+	{
+		if (retired.Controls == nullptr) return;
+		for (s64 pos = retired.migrated; pos < retired.capacity && retired.count > 0; ++pos)
+			if (retired.Controls[pos] >= 0) migrate_entry(pos);
+		release_retired();
+	}
+
+	// frees retired table, all its entries have to be moved or destructed already
+	void release_retired()
+	{
+		free(retired.Controls);
+		free(retired.Keys);
+		free(retired.Values);
+		retired = retired_table();
+	}
+
+	// retires current table and allocates a new one, entries are moved later by migrate_step
+	void start_resize(s64 new_size)
+	{
+		detach();
+		finish_migration();
+		if (new_size < INITIAL_CAPACITY) new_size = INITIAL_CAPACITY;
+		new_size = (s64)round_up_pow2((u64)new_size);
+
+		const s64 old_count = count;
+		retired.Controls = Controls;
+		retired.Keys = Keys;
+		retired.Values = Values;
+		retired.capacity = capacity;
+		retired.count = count;
+		retired.migrated = 0;
+		// keys keep pointing into retired arena until they are moved
+		retired.arena = std::move(arena);
+		arena = typename traits::arena();
+
+		allocate(new_size);
+		count = old_count;
+	}
+
+	// moves all entries into a new table at once
 	void resize(s64 new_size)
 	{
-		s64 entry_size = sizeof(key_entry) > sizeof(type) ? sizeof(key_entry) : sizeof(type);
-		if ((new_size * entry_size) / new_size != entry_size)
-			ERROR("HashMap: capacity expansion failed, given new_size(%d) * entry_size(%d) overflows", new_size, entry_size);
+		detach();
+		finish_migration();
+		if (new_size < INITIAL_CAPACITY) new_size = INITIAL_CAPACITY;
+		new_size = (s64)round_up_pow2((u64)new_size);
 
-		key_entry* new_Keys = (key_entry*)malloc(sizeof(key_entry) * new_size);
-		type* new_Values = (type*)malloc(sizeof(type) * new_size);
-		if (new_Keys == nullptr || new_Values == nullptr)
-			ERROR("HashMap: failed to allocated memory to resize object");
-		for (s64 new_pos = 0; new_pos < new_size; ++new_pos) new(new_Keys + new_pos) key_entry();
+		s8* old_Controls = Controls;
+		key_entry* old_Keys = Keys;
+		Value* old_Values = Values;
+		const s64 old_capacity = capacity;
+		const s64 old_count = count;
+		// arena is rebuilt while relocating keys, dropping removed ones
+		typename traits::arena old_arena(std::move(arena));
 
-		for (s64 pos = 0; pos < capacity; ++pos)
+		allocate(new_size);
+		for (s64 pos = 0; pos < old_capacity; ++pos)
 		{
-			if (Keys[pos].key == nullptr) continue;
-			u64 new_pos = hashCode(Keys[pos].key, Keys[pos].length) % (u64)new_size;
-			while (new_Keys[new_pos].key != nullptr) new_pos = (new_pos + 1) % (u64)new_size;
-			new_Keys[new_pos] = Keys[pos];
-			new (new_Values + new_pos) type(std::move(Values[pos])); Values[pos].~type();
+			if (old_Controls[pos] < 0) continue;
+			// cached hash is reused, no key is rehashed or compared
+			const u64 hash = old_Keys[pos].hash;
+			const s64 new_pos = free_position(hash);
+			set_ctrl(new_pos, h2(hash));
+			Keys[new_pos].hash = hash;
+			traits::relocate(&Keys[new_pos].key, old_Keys[pos].key, old_arena, arena);
+			new (Values + new_pos) Value(std::move(old_Values[pos])); old_Values[pos].~Value();
 		}
-		free(Keys);
-		free(Values);
+		count = old_count;
+
+		free(old_Controls);
+		free(old_Keys);
+		free(old_Values);
+	}
+
+	// removes key and associated value, returns false if key is not present
+	bool key_remove(key_view key, u64 hash)
+	{
+		const s64 pos = settled_position(key, hash);
+		if (pos == -1) return false; // no element to remove
+		if (mapping.is_open()) return detach(), key_remove(key, hash);
+
+		traits::destroy(Keys[pos].key, arena);
+		Values[pos].~Value();
+		--count;
+
+		// probe only continues past a group with no empty slots, if slot never was inside such group
+		// it can become empty again, otherwise it's marked deleted so that probe sequences passing it stay intact
+		s64 before = pos - GROUP_WIDTH;
+		if (before < 0) before += capacity;
+		const u32 empty_before = ctrl_group(Controls + before).match_empty();
+		const u32 empty_after = ctrl_group(Controls + pos).match_empty();
+		const bool was_never_full = empty_before != 0 && empty_after != 0 &&
+			(count_leading_zeros(empty_before) - (32 - GROUP_WIDTH)) + count_trailing_zeros(empty_after) < GROUP_WIDTH;
+		if (was_never_full) set_ctrl(pos, CTRL_EMPTY);
+		else
+		{
+			set_ctrl(pos, CTRL_DELETED);
+			++deleted;
+		}
+
+		if (count > INITIAL_CAPACITY && count * 8 <= capacity)
+		{
+			if (incremental) start_resize(capacity / 2);
+			else resize(capacity / 2);
+		}
+		// inserting and removing at steady size never resizes, rehashing into the same capacity compacts arena
+		else if (traits::arena_wasteful(arena, capacity))
+		{
+			if (incremental) start_resize(capacity);
+			else resize(capacity);
+		}
+		return true;
+	}
+
+	// starts loading everything the probe for given hash touches first, so that
+	// probes of a whole batch wait for memory at the same time instead of one after another
+	void prefetch_home(u64 hash) const
+	{
+		const s64 pos = home(hash);
+		prefetch(Controls + pos);
+		prefetch(Keys + pos);
+		prefetch(Values + pos);
+	}
+
+	// constructs map without any memory, for open to point at mapped file
+	// first argument only tells it apart from HashMap(s64 size)
+	HashMap(int, s64 capacity, u64 arena_size, u64 seed): Controls(nullptr), Keys(nullptr), Values(nullptr),
+		capacity(capacity), count(0), deleted(0), seed(seed), retired(), incremental(false), hasher(), equal()
+	{
+		traits::arena_borrow(arena, nullptr, arena_size);
+	}
 
-		Keys = new_Keys;
-		Values = new_Values;
-		this->capacity = new_size;
+	// copies map opened from a snapshot into map owned memory and unmaps the file
+	void detach()
+	{
+		if (!mapping.is_open()) return;
+		// copy constructor never maps, old mapped data is released with the argument of the assignment
+		*this = HashMap(*this);
+	}
+
+	// returns where sections of a snapshot of this map start
+	snapshot_header snapshot_layout() const
+	{
+		auto align = [](u64 offset) { return (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT; };
+
+		snapshot_header header;
+		memset(&header, 0, sizeof(header));
+		header.magic = SNAPSHOT_MAGIC;
+		header.version = SNAPSHOT_VERSION;
+		header.key_entry_size = sizeof(key_entry);
+		header.value_size = sizeof(Value);
+		header.group_width = GROUP_WIDTH;
+		header.capacity = capacity;
+		header.count = count;
+		header.deleted = deleted;
+		header.seed = seed;
+		header.arena_size = traits::arena_size(arena);
+
+		header.controls_offset = align(sizeof(snapshot_header));
+		header.keys_offset = align(header.controls_offset + capacity + GROUP_WIDTH);
+		header.values_offset = align(header.keys_offset + sizeof(key_entry) * capacity);
+		header.arena_offset = align(header.values_offset + sizeof(Value) * capacity);
+		header.file_size = header.arena_offset + header.arena_size;
+		return header;
+	}
+
+	// destructs all entries, leaving memory allocated
+	void destructInternalData()
+	{
+		for (s64 pos = 0; pos < capacity; ++pos)
+		{
+			if (Controls[pos] < 0) continue;
+			traits::destroy(Keys[pos].key, arena);
+			Values[pos].~Value();
+		}
+		for (s64 pos = 0; pos < retired.capacity; ++pos)
+		{
+			if (retired.Controls[pos] < 0) continue;
+			traits::destroy(retired.Keys[pos].key, retired.arena);
+			retired.Values[pos].~Value();
+		}
 	}
 
 public:
 
-	class iterator //: public std::iterator<std::input_iterator_tag, char*>
+	class iterator //: public std::iterator<std::input_iterator_tag, Key>
 	{
 		const HashMap* map;
 		s64 pos;
 
+		// moves pos to the first full slot starting from given position (end if there is none)
+		// positions past current table's capacity are slots of retired table
+		void seek(s64 pos)
+		{
+			while (pos < map->capacity && map->Controls[pos] < 0) ++pos;
+			if (pos >= map->capacity)
+			{
+				const s64 end = map->capacity + map->retired.capacity;
+				while (pos < end && map->retired.Controls[pos - map->capacity] < 0) ++pos;
+			}
+			this->pos = pos;
+		}
+
 	public:
 
 		// default non usable constructor, which returns invalid iterator
-		iterator() : map(nullptr), pos(nullptr) { /* empty */ }
+		iterator() : map(nullptr), pos(0) { /* empty */ }
 
 		// end indicates to initialize end iterator
 		iterator(const HashMap* map, bool end = false)
 		{
 			this->map = map;
-			if (!end)
-			{
-				s64 pos = 0;
-				while (pos < map->capacity)
-				{
-					if (map->Keys[pos].key != nullptr)
-					{
-						this->pos = pos; break;
-					}
-					++pos;
-				}
-				if (pos == map->capacity) this->pos = map->capacity;
-			}
-			else this->pos = map->capacity;
+			if (!end) seek(0);
+			else this->pos = map->capacity + map->retired.capacity;
 		}
 
 		// copy constructor
@@ -153,19 +1021,9 @@ public:
 			this->pos = it.pos;
 		}
 
-		iterator & operator++() 
+		iterator & operator++()
 		{
-			s64 pos = this->pos + 1;
-			while (pos < map->capacity)
-			{
-				if (map->Keys[pos].key != nullptr)
-				{
-					this->pos = pos; break;
-				}
-				++pos;
-			}
-			if (pos == map->capacity) this->pos = map->capacity;
-			
+			seek(pos + 1);
 			return *this;
 		}
 
@@ -176,8 +1034,11 @@ public:
 			return result;
 		}
 
-		const char* operator*() { return map->Keys[pos].key; }
-		const char** operator->() { return &map->Keys[pos].key; }
+		typename traits::reference operator*() const
+		{
+			if (pos < map->capacity) return traits::get(map->Keys[pos].key, map->arena);
+			return traits::get(map->retired.Keys[pos - map->capacity].key, map->retired.arena);
+		}
 
 		bool operator==(const iterator & it) const { return this->map == it.map && this->pos == it.pos; }
 		bool operator!=(const iterator & it) const { return !(*this == it); }
@@ -187,161 +1048,340 @@ public:
 	iterator end() const { return iterator(this, /*end*/ true); }
 
 
-	HashMap()
-	{
-		count = 0;
-		capacity = INITIAL_CAPACITY;
-		Keys = (key_entry*)malloc(sizeof(key_entry) * capacity);
-		Values = (type*)malloc(sizeof(type) * capacity);
-		if (Keys == nullptr || Values == nullptr)
-			ERROR("HashMap: failed to allocated memory to construct object");
-		for (s64 pos = 0; pos < capacity; ++pos) new(Keys + pos) key_entry();
-	}
+	HashMap(): seed(hash_seed()), retired(), incremental(false), hasher(), equal() { allocate(INITIAL_CAPACITY); }
 
-	HashMap(s64 size)
+	// size is amount of entries map should hold without resizing
+	HashMap(s64 size): seed(hash_seed()), retired(), incremental(false), hasher(), equal()
 	{
-		if (size <= 0) ERROR("HashMap: size provided to constructor has to be positive, given %d", size);
-		count = 0;
-		capacity = size > INITIAL_CAPACITY ? size : INITIAL_CAPACITY;
-
-		s64 entry_size = sizeof(key_entry) > sizeof(type) ? sizeof(key_entry) : sizeof(type);
-		if ((size * entry_size) / size != entry_size)
-			ERROR("HashMap: size provided to constructor overflows: size(%d) * entry_size(%d)", size, entry_size);
-
-		Keys = (key_entry*)malloc(sizeof(key_entry) * capacity);
-		Values = (type*)malloc(sizeof(type) * capacity);
-		if (Keys == nullptr || Values == nullptr)
-			ERROR("HashMap: failed to allocated memory to construct object");
-		for (s64 pos = 0; pos < capacity; ++pos) new(Keys + pos) key_entry();
+		if (size <= 0) ERROR("HashMap: size provided to constructor has to be positive, given %lld", size);
+		s64 capacity = size + size / 7 + 1; // keeps load factor under 7/8
+		allocate((s64)round_up_pow2(capacity > INITIAL_CAPACITY ? capacity : INITIAL_CAPACITY));
 	}
 
 	// copy constructor
-	HashMap(const HashMap<type> & map)
+	// copy of a map in the middle of incremental resize gets all entries in one table
+	HashMap(const HashMap & map): seed(map.seed), retired(), incremental(map.incremental), hasher(map.hasher), equal(map.equal)
 	{
+		allocate(map.capacity);
+		memcpy(Controls, map.Controls, capacity + GROUP_WIDTH);
+		for (s64 pos = 0; pos < capacity; ++pos)
+		{
+			if (Controls[pos] < 0) continue;
+			Keys[pos].hash = map.Keys[pos].hash;
+			traits::construct(&Keys[pos].key, traits::get_view(map.Keys[pos].key, map.arena), arena);
+			new (Values + pos) Value(map.Values[pos]);
+		}
+		deleted = map.deleted;
+		for (s64 pos = 0; pos < map.retired.capacity; ++pos)
+		{
+			if (map.retired.Controls[pos] < 0) continue;
+			const u64 hash = map.retired.Keys[pos].hash;
+			const s64 new_pos = free_position(hash);
+			if (Controls[new_pos] == CTRL_DELETED) --deleted;
+			set_ctrl(new_pos, h2(hash));
+			Keys[new_pos].hash = hash;
+			traits::construct(&Keys[new_pos].key, traits::get_view(map.retired.Keys[pos].key, map.retired.arena), arena);
+			new (Values + new_pos) Value(map.retired.Values[pos]);
+		}
 		count = map.count;
-		capacity = map.capacity;
-		Keys = (key_entry*)malloc(sizeof(char) * capacity);
-		Values = (type*)malloc(sizeof(type) * capacity);
-		if (Keys == nullptr || Values == nullptr)
-			ERROR("HashMap: failed to allocate memory to copy construct");
-		for (s64 pos = 0; pos < capacity; ++pos) Keys[pos] = key_entry(map.Keys[pos].key, map.Keys[pos].length);
-		for (s64 pos = 0; pos < capacity; ++pos) new (Values + pos) type(Values[pos]);
 	}
 
 	// move constructor
-	HashMap(HashMap<type> && map)
+	HashMap(HashMap && map): arena(std::move(map.arena)), seed(map.seed), retired(std::move(map.retired)), incremental(map.incremental),
+		mapping(std::move(map.mapping)), hasher(map.hasher), equal(map.equal)
 	{
-		count = map.count;
-		capacity = map.capacity;
+		map.retired = retired_table();
+		Controls = map.Controls;
 		Keys = map.Keys;
 		Values = map.Values;
+		capacity = map.capacity;
+		count = map.count;
+		deleted = map.deleted;
 
-		map.count = 0;
-		map.capacity = 0;
+		map.Controls = nullptr;
 		map.Keys = nullptr;
 		map.Values = nullptr;
+		map.capacity = map.count = map.deleted = 0;
 	}
 
 	// copy/move assignment utilizing copy/move constructor by taking argument as value
-	HashMap & operator=(HashMap<type> map)
+	HashMap & operator=(HashMap map)
 	{
-		// swap
-		s64 capacity_temp = capacity;
-		s64 count_temp = count;
-		key_entry* Keys_temp = Keys;
-		type* Values_temp = Values;
-
-		capacity = map.capacity;
-		count = map.count;
-		Keys = map.Keys;
-		Values = map.Values;
-
-		map.capacity = capacity_temp;
-		map.count = count_temp;
-		map.Keys = Keys_temp;
-		map.Values = Values_temp;
+		// qualified, so that pointers to std types don't find std::swap as well
+		::swap(Controls, map.Controls);
+		::swap(Keys, map.Keys);
+		::swap(Values, map.Values);
+		::swap(capacity, map.capacity);
+		::swap(count, map.count);
+		::swap(deleted, map.deleted);
+		::swap(arena, map.arena);
+		::swap(seed, map.seed);
+		::swap(retired, map.retired);
+		::swap(incremental, map.incremental);
+		::swap(mapping, map.mapping);
+		::swap(hasher, map.hasher);
+		::swap(equal, map.equal);
 		// map going out of scope will destruct old HashMap's object's data
 		return *this;
 	}
 
 	~HashMap()
 	{
-		// call destructor manually on all objects, since allocation and construction is done separately
-		for (s64 pos = 0; pos < capacity; ++pos)
+		if (mapping.is_open())
 		{
-			if (Keys[pos].key == nullptr) continue;
-			free(Keys[pos].key);
-			Values[pos].~type();
+			// nothing is owned, mapping closes itself
+			traits::arena_release(arena);
+			return;
 		}
+		// call destructor manually on all objects, since allocation and construction is done separately
+		if (Controls != nullptr) destructInternalData();
+		free(Controls);
 		free(Keys);
 		free(Values);
-		capacity = count = 0;
+		capacity = count = deleted = 0;
+		release_retired();
 	}
 
-	inline s64 size() { return count; }
-	inline bool isEmpty() { return count == 0; }
+	inline s64 size() const { return count; }
+	inline bool isEmpty() const { return count == 0; }
 
+	// in incremental mode growing or shrinking only allocates a new table, entries of the old one are moved
+	// MIGRATION_STEP slots per insert, lookup or remove, so no single operation pays for rehashing the whole map
+	// const lookups search both tables without moving anything, bulk operations and reserve finish migration first
+	// turning it off finishes resize in progress
+	void set_incremental_resize(bool enabled)
+	{
+		incremental = enabled;
+		if (!incremental) finish_migration();
+	}
 
-	// key length can't exceed 2^16 - 1
-	void insert(const char* key, const type & value) { key_insert(key, value); }
+	inline bool is_resizing() const { return retired.Controls != nullptr; }
 
-	// usage: if (map.contains(key)) ...
-	bool contains(const char* key) { return key_position(key) != -1; }
+	// bytes held by arenas for keys too long to be stored inline, removed keys included until arena is compacted
+	u64 arena_bytes() const { return traits::arena_size(arena) + traits::arena_size(retired.arena); }
 
-	// safe usage: if (map.contains(key)) value = map.get(key);
-	// if we are sure that key is present, we can ignore contains check
-	type get(const char* key)
+	// moves all entries left from incremental resize into current table
+	void finish_resize() { finish_migration(); }
+
+	// writes map into a flat file, which open can map back without any parsing or copying
+	// keys and values have to be trivially copyable (c string keys are), returns false if writing fails
+	bool save(const char* filename) const
 	{
-		const s64 pos = key_position(key);
-		if (pos == -1)
-			ERROR("HashMap: '%s' key is not in a map, before getting a value associated with a key, use map.contains(key) to verify that key:value pair is in a map", key);
-		return Values[pos];
-	}
+		static_assert(std::is_trivially_copyable<typename traits::stored>::value && std::is_trivially_copyable<Value>::value,
+			"HashMap: only maps with trivially copyable keys and values can be saved");
 
-	// usage: map[key]
-	// get and set/insert element through [] operator
-	// if key is present, reference of value associated with key is returned
-	// if not present, a new entry is created for that key with default type value
-	type & operator[](const char* key)
-	{		
-		s64 pos = key_position(key);
-		if (pos == -1) pos = key_insert(key, type());
-		return Values[pos];
+		// snapshot holds a single table, copy has all entries in one
+		if (retired.Controls != nullptr) return HashMap(*this).save(filename);
+
+		const snapshot_header header = snapshot_layout();
+		FILE* file = nullptr;
+#if defined(_WIN32)
+		if (fopen_s(&file, filename, "wb") != 0) file = nullptr;
+#else
+		file = fopen(filename, "wb");
+#endif
+		if (file == nullptr) return false;
+
+		// sections are written in order, zero padding up to where the next one starts
+		u64 written = 0;
+		auto write = [file, &written](const void* data, u64 offset, u64 size)
+		{
+			static const char padding[SNAPSHOT_ALIGNMENT] = { 0 };
+			bool success = true;
+			while (written < offset && success)
+			{
+				const u64 pad = offset - written < SNAPSHOT_ALIGNMENT ? offset - written : SNAPSHOT_ALIGNMENT;
+				success = fwrite(padding, 1, (size_t)pad, file) == pad;
+				written += pad;
+			}
+			success = success && (size == 0 || fwrite(data, 1, (size_t)size, file) == size);
+			written += size;
+			return success;
+		};
+
+		bool success = write(&header, 0, sizeof(header)) &&
+			write(Controls, header.controls_offset, capacity + GROUP_WIDTH) &&
+			write(Keys, header.keys_offset, sizeof(key_entry) * capacity) &&
+			write(Values, header.values_offset, sizeof(Value) * capacity) &&
+			write(traits::arena_data(arena), header.arena_offset, header.arena_size);
+		success = fclose(file) == 0 && success;
+		return success;
 	}
 
-	// usage: map.remove(key);
-	void remove(const char* key)
+	// replaces content of this map with a snapshot written by save, file is mapped into memory and
+	// lookups and iteration read directly from it, first change to the map copies it into map owned memory
+	// returns false (map left untouched) if file can't be mapped or isn't a snapshot of a map with the same types
+	bool open(const char* filename)
 	{
-		s64 pos = key_position(key);
-		if (pos == -1) return; // no element to remove
+		static_assert(std::is_trivially_copyable<typename traits::stored>::value && std::is_trivially_copyable<Value>::value,
+			"HashMap: only maps with trivially copyable keys and values can be opened from a snapshot");
 
-		free(Keys[pos].key); Keys[pos].key = nullptr; Key[pos].length = 0;
-		Values[pos].~type();
-		--count;
+		file_mapping file;
+		if (!file.open(filename)) return false;
+		if (file.size < sizeof(snapshot_header)) return false;
+
+		const snapshot_header & header = *(const snapshot_header*)file.data;
+		if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION ||
+			header.key_entry_size != sizeof(key_entry) || header.value_size != sizeof(Value) ||
+			header.group_width != GROUP_WIDTH || header.capacity < GROUP_WIDTH || (header.capacity & (header.capacity - 1)) != 0 ||
+			header.file_size != file.size)
+			return false;
+
+		// layout is recomputed from the header's own fields, so offsets can't point outside the file
+		HashMap map(0, header.capacity, header.arena_size, header.seed);
+		const snapshot_header layout = map.snapshot_layout();
+		if (layout.controls_offset != header.controls_offset || layout.keys_offset != header.keys_offset ||
+			layout.values_offset != header.values_offset || layout.arena_offset != header.arena_offset ||
+			layout.file_size != header.file_size)
+			return false;
+
+		char* base = (char*)file.data;
+		map.Controls = (s8*)(base + header.controls_offset);
+		map.Keys = (key_entry*)(base + header.keys_offset);
+		map.Values = (Value*)(base + header.values_offset);
+		map.count = header.count;
+		map.deleted = header.deleted;
+		traits::arena_borrow(map.arena, base + header.arena_offset, header.arena_size);
+		map.mapping = std::move(file);
 
-		if (count > INITIAL_CAPACITY && count * 8 == capacity)
+		*this = std::move(map);
+		return true;
+	}
+
+	// returns histogram of probe lengths: element at index d is amount of entries
+	// placed d slots past their home slot (slot the probe for that key starts from)
+	// only current table is counted, entries not yet moved by incremental resize are left out
+	Array<s64> probe_histogram() const
+	{
+		Array<s64> histogram;
+		for (s64 pos = 0; pos < capacity; ++pos)
 		{
-			// after resizing, there's no gap to fill
-			resize(capacity / 2); return;
+			if (Controls[pos] < 0) continue;
+			s64 distance = pos - home(Keys[pos].hash);
+			if (distance < 0) distance += capacity;
+			while (histogram.size() <= distance) histogram.insert(0);
+			histogram[distance] += 1;
 		}
+		return histogram;
+	}
+
+
+	// makes room for at least size entries, so that no resize happens until map holds that many
+	void reserve(s64 size)
+	{
+		finish_migration();
+		// keeps load factor under 7/8 with all current deleted slots still occupied
+		const s64 needed = size + deleted + (size + deleted) / 7 + 1;
+		if (needed > capacity) resize(needed);
+	}
+
+	// returns hash of a key, which can be passed along with the key to avoid hashing it again
+	u64 hash(key_view key) const { return traits::hash(hasher, key, seed); }
+
+
+	void insert(key_view key, Value value) { key_insert(key, hash(key), std::move(value)); }
+	void insert(const hashed_key & key, Value value) { key_insert(key.key, key.hash, std::move(value)); }
 
-		// reallocate next elements to fill a gap
-		pos = (pos + 1) % (u64)capacity;
-		while(Keys[pos].key != nullptr)
+	// inserts n key:value pairs, keys[i] being associated with values[i]
+	// map is resized at most once up front, keys are hashed and prefetched in batches
+	void insert_bulk(const Key* keys, const Value* values, s64 n)
+	{
+		// also finishes incremental resize, so batch isn't slowed down by migration
+		reserve(count + n);
+		u64 hashes[BATCH_SIZE];
+		for (s64 start = 0; start < n; start += BATCH_SIZE)
 		{
-			key_entry key_reallocate = Keys[pos];
-			Keys[pos].key = nullptr; Keys[pos].length = 0;
-			type value_reallocate(std::move(Values[pos])); Values[pos].~type();
-			u64 pos_reallocate = hashCode(key_reallocate.key, key_reallocate.length) % (u64)capacity;
+			const s64 batch = n - start < BATCH_SIZE ? n - start : BATCH_SIZE;
+			for (s64 i = 0; i < batch; ++i)
+			{
+				hashes[i] = hash(keys[start + i]);
+				prefetch_home(hashes[i]);
+			}
+			for (s64 i = 0; i < batch; ++i)
+				key_insert(keys[start + i], hashes[i], Value(values[start + i]));
+		}
+	}
 
-			while (Keys[pos_reallocate].key != nullptr) pos_reallocate = (pos_reallocate + 1) % (u64)capacity;
-			Keys[pos_reallocate]   = key_reallocate;
-			Values[pos_reallocate] = std::move(value_reallocate);
+	// looks up n keys, out[i] is set to pointer to the value associated with keys[i], nullptr if it's not present
+	// keys are hashed and their home slots prefetched a batch at a time before probing,
+	// so memory latency of a whole batch overlaps instead of being paid for every key separately
+	void find_batch(const Key* keys, s64 n, Value** out)
+	{
+		const HashMap & map = *this;
+		map.find_batch(keys, n, (const Value**)out);
+	}
 
-			pos = (pos + 1) % (u64)capacity;
+	void find_batch(const Key* keys, s64 n, const Value** out) const
+	{
+		u64 hashes[BATCH_SIZE];
+		for (s64 start = 0; start < n; start += BATCH_SIZE)
+		{
+			const s64 batch = n - start < BATCH_SIZE ? n - start : BATCH_SIZE;
+			for (s64 i = 0; i < batch; ++i)
+			{
+				hashes[i] = hash(keys[start + i]);
+				prefetch_home(hashes[i]);
+			}
+			for (s64 i = 0; i < batch; ++i)
+				out[start + i] = value_of(keys[start + i], hashes[i]);
 		}
 	}
+
+	// usage: if (map.contains(key)) ...
+	bool contains(key_view key) const { return value_of(key, hash(key)) != nullptr; }
+	bool contains(const hashed_key & key) const { return value_of(key.key, key.hash) != nullptr; }
+
+	// returns pointer to value associated with key, nullptr if key is not present
+	Value* find(key_view key) { return find(hashed_key(hash(key), key)); }
+	const Value* find(key_view key) const { return find(hashed_key(hash(key), key)); }
+
+	Value* find(const hashed_key & key)
+	{
+		const s64 pos = settled_position(key.key, key.hash);
+		return pos == -1 ? nullptr : Values + pos;
+	}
+
+	const Value* find(const hashed_key & key) const { return value_of(key.key, key.hash); }
+
+	// safe usage: if (map.contains(key)) value = map.get(key);
+	// if we are sure that key is present, we can ignore contains check
+	const Value & get(key_view key) const { return get(hashed_key(hash(key), key)); }
+
+	const Value & get(const hashed_key & key) const
+	{
+		const Value* value = value_of(key.key, key.hash);
+		if (value == nullptr)
+			ERROR("HashMap: key is not in a map, before getting a value associated with a key, use map.contains(key) to verify that key:value pair is in a map");
+		return *value;
+	}
+
+	// if key is not present, inserts it with value constructed in place from given arguments
+	// if it is present, nothing is constructed and existing value is returned
+	template <typename... Args>
+	emplace_result try_emplace(key_view key, Args&&... args) { return try_emplace(hashed_key(hash(key), key), std::forward<Args>(args)...); }
+
+	template <typename... Args>
+	emplace_result try_emplace(const hashed_key & key, Args&&... args)
+	{
+		s64 pos = settled_position(key.key, key.hash);
+		if (pos != -1) return emplace_result{ Values + pos, false };
+
+		pos = claim_slot(key.key, key.hash);
+		new (Values + pos) Value(std::forward<Args>(args)...);
+		return emplace_result{ Values + pos, true };
+	}
+
+	// usage: map[key]
+	// get and set/insert element through [] operator
+	// if key is present, reference of value associated with key is returned
+	// if not present, a new entry is created for that key with default Value
+	Value & operator[](key_view key) { return *try_emplace(hashed_key(hash(key), key)).value; }
+	Value & operator[](const hashed_key & key) { return *try_emplace(key).value; }
+
+	// usage: map.remove(key);
+	void remove(key_view key) { key_remove(key, hash(key)); }
+	void remove(const hashed_key & key) { key_remove(key.key, key.hash); }
 };
 
 
-#endif
\ No newline at end of file
+#endif
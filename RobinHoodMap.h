@@ -0,0 +1,406 @@
+#ifndef _robinhoodmap_h
+#define _robinhoodmap_h
+
+#include "HashMap.h" // hash and equality policies, key_traits
+#include "Array.h"
+#include "utility.h"
+
+
+// open addressing hash map with Robin Hood linear probing
+// every slot knows how far its entry sits from its home slot (probe distance), entries are kept ordered
+// so that probe distance never grows by more than one from slot to slot, which keeps probes short even at 90% load
+// remove shifts following entries one slot back instead of leaving deleted slots behind
+// has HashMap's basic interface, uses the same Hash and Eq policies
+template <typename Key, typename Value, typename Hash = hash_of<Key>, typename Eq = key_equal<Key>>
+class RobinHoodMap
+{
+	typedef key_traits<Key> traits;
+	typedef typename traits::view key_view;
+
+	struct key_entry
+	{
+		u64 hash;
+		typename traits::stored key;
+	};
+
+	// probe distance + 1 of each slot's entry, 0 marks an empty slot
+	u8* Distances;
+	key_entry* Keys;
+	Value* Values;
+
+	s64 capacity; // allocated size, always power of 2
+	s64 count; // effective size
+	u32 shift; // 64 - log2(capacity), home slot is given by the top log2(capacity) bits of scrambled hash
+
+	typename traits::arena arena;
+
+	// random per map, cached hashes are only valid with the seed they were computed with
+	u64 seed;
+
+	Hash hasher;
+	Eq equal;
+
+	// will double every time reaches limit
+	static const s64 INITIAL_CAPACITY = 64;
+	// entry is never placed further than this from its home slot, map grows instead
+	static const u32 MAX_DISTANCE = 255;
+
+	u64 hash_key(key_view key) const { return traits::hash(hasher, key, seed); }
+
+	// fibonacci hashing: multiplying by 2^64 / golden ratio spreads even weak lower bits into the top ones
+	inline s64 home(u64 hash) const { return (s64)((hash * 11400714819323198485ULL) >> shift); }
+	inline s64 next(s64 pos) const { return (pos + 1) & (capacity - 1); }
+	inline s64 previous(s64 pos) const { return (pos - 1) & (capacity - 1); }
+
+	// max load factor is 9/10, returns true if one more entry can't be added without breaking it
+	bool is_overloaded() const { return (count + 1) * 10 > capacity * 9; }
+
+	// allocates arrays for given capacity with all slots empty
+	void allocate(s64 size)
+	{
+		const s64 entry_size = sizeof(key_entry) + sizeof(Value) + sizeof(u8);
+		if ((size * entry_size) / size != entry_size)
+			ERROR("RobinHoodMap: allocation failed, given size(%lld) * entry_size(%lld) overflows", size, entry_size);
+
+		Distances = (u8*)malloc(sizeof(u8) * size);
+		Keys = (key_entry*)malloc(sizeof(key_entry) * size);
+		Values = (Value*)malloc(sizeof(Value) * size);
+		if (Distances == nullptr || Keys == nullptr || Values == nullptr)
+			ERROR("RobinHoodMap: failed to allocate memory for %lld entries", size);
+		memset(Distances, 0, size);
+
+		capacity = size;
+		count = 0;
+		shift = 64 - log2_pow2((u64)size);
+	}
+
+	// moves entry from one slot to another, giving it a new probe distance
+	void move_entry(s64 to, s64 from, u32 distance)
+	{
+		Distances[to] = (u8)distance;
+		Keys[to].hash = Keys[from].hash;
+		traits::move(&Keys[to].key, Keys[from].key);
+		new (Values + to) Value(std::move(Values[from])); Values[from].~Value();
+	}
+
+	// returns key position in Keys array, -1 if key is not present
+	s64 key_position(key_view key, u64 hash) const
+	{
+		s64 pos = home(hash);
+		// once a slot's entry is closer to its home than the key would be, key can't be further along
+		for (u32 distance = 1; distance <= Distances[pos]; ++distance)
+		{
+			if (Keys[pos].hash == hash && traits::equal(equal, Keys[pos].key, key, arena)) return pos;
+			pos = next(pos);
+		}
+		return -1;
+	}
+
+	// finds where an entry with given hash belongs: the first slot whose entry is closer to its home
+	// entries from there up to the next empty slot are shifted one slot forward to make room
+	// returns the freed slot with its distance set, -1 if some entry would exceed MAX_DISTANCE
+	s64 make_room(u64 hash)
+	{
+		s64 pos = home(hash);
+		u32 distance = 1;
+		while (distance <= Distances[pos])
+		{
+			pos = next(pos);
+			++distance;
+		}
+		if (distance > MAX_DISTANCE) return -1;
+
+		s64 empty = pos;
+		while (Distances[empty] != 0)
+		{
+			if (Distances[empty] == MAX_DISTANCE) return -1;
+			empty = next(empty);
+		}
+		// shift starting from the back, so every entry moves into an already vacated slot
+		while (empty != pos)
+		{
+			const s64 prev = previous(empty);
+			move_entry(empty, prev, Distances[prev] + 1u);
+			empty = prev;
+		}
+
+		Distances[pos] = (u8)distance;
+		return pos;
+	}
+
+	// occupies a slot for a key, which is not present in a map, and returns its position
+	// key is constructed, value at returned position is left for the caller to construct
+	s64 claim_slot(key_view key, u64 hash)
+	{
+		if (is_overloaded()) resize(capacity * 2);
+
+		s64 pos = make_room(hash);
+		while (pos == -1)
+		{
+			resize(capacity * 2);
+			pos = make_room(hash);
+		}
+
+		Keys[pos].hash = hash;
+		traits::construct(&Keys[pos].key, key, arena);
+		++count;
+		return pos;
+	}
+
+	void resize(s64 new_size)
+	{
+		if (new_size < INITIAL_CAPACITY) new_size = INITIAL_CAPACITY;
+		new_size = (s64)round_up_pow2((u64)new_size);
+
+		u8* old_Distances = Distances;
+		key_entry* old_Keys = Keys;
+		Value* old_Values = Values;
+		const s64 old_capacity = capacity;
+		const s64 old_count = count;
+		// arena is rebuilt while relocating keys, dropping removed ones
+		typename traits::arena old_arena(std::move(arena));
+
+		allocate(new_size);
+		for (s64 pos = 0; pos < old_capacity; ++pos)
+		{
+			if (old_Distances[pos] == 0) continue;
+			// cached hash is reused, no key is rehashed or compared
+			const u64 hash = old_Keys[pos].hash;
+			const s64 new_pos = make_room(hash);
+			if (new_pos == -1)
+				ERROR("RobinHoodMap: resize failed, too many keys share the same hash");
+			Keys[new_pos].hash = hash;
+			traits::relocate(&Keys[new_pos].key, old_Keys[pos].key, old_arena, arena);
+			new (Values + new_pos) Value(std::move(old_Values[pos])); old_Values[pos].~Value();
+		}
+		count = old_count;
+
+		free(old_Distances);
+		free(old_Keys);
+		free(old_Values);
+	}
+
+	// destructs all entries, leaving memory allocated
+	void destructInternalData()
+	{
+		for (s64 pos = 0; pos < capacity; ++pos)
+		{
+			if (Distances[pos] == 0) continue;
+			traits::destroy(Keys[pos].key, arena);
+			Values[pos].~Value();
+		}
+	}
+
+public:
+
+	class iterator //: public std::iterator<std::input_iterator_tag, Key>
+	{
+		const RobinHoodMap* map;
+		s64 pos;
+
+		// moves pos to the first full slot starting from given position (capacity if there is none)
+		void seek(s64 pos)
+		{
+			while (pos < map->capacity && map->Distances[pos] == 0) ++pos;
+			this->pos = pos;
+		}
+
+	public:
+
+		// default non usable constructor, which returns invalid iterator
+		iterator() : map(nullptr), pos(0) { /* empty */ }
+
+		// end indicates to initialize end iterator
+		iterator(const RobinHoodMap* map, bool end = false)
+		{
+			this->map = map;
+			if (!end) seek(0);
+			else this->pos = map->capacity;
+		}
+
+		// copy constructor
+		iterator(const iterator & it)
+		{
+			this->map = it.map;
+			this->pos = it.pos;
+		}
+
+		iterator & operator++()
+		{
+			seek(pos + 1);
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			iterator result(*this);
+			++(*this);
+			return result;
+		}
+
+		typename traits::reference operator*() const { return traits::get(map->Keys[pos].key, map->arena); }
+
+		bool operator==(const iterator & it) const { return this->map == it.map && this->pos == it.pos; }
+		bool operator!=(const iterator & it) const { return !(*this == it); }
+	};
+
+	iterator begin() const { return iterator(this); }
+	iterator end() const { return iterator(this, /*end*/ true); }
+
+
+	RobinHoodMap(): seed(hash_seed()), hasher(), equal() { allocate(INITIAL_CAPACITY); }
+
+	// size is amount of entries map should hold without resizing
+	RobinHoodMap(s64 size): seed(hash_seed()), hasher(), equal()
+	{
+		if (size <= 0) ERROR("RobinHoodMap: size provided to constructor has to be positive, given %lld", size);
+		s64 capacity = size + size / 9 + 1; // keeps load factor under 9/10
+		allocate((s64)round_up_pow2(capacity > INITIAL_CAPACITY ? capacity : INITIAL_CAPACITY));
+	}
+
+	// copy constructor
+	RobinHoodMap(const RobinHoodMap & map): seed(map.seed), hasher(map.hasher), equal(map.equal)
+	{
+		allocate(map.capacity);
+		memcpy(Distances, map.Distances, capacity);
+		for (s64 pos = 0; pos < capacity; ++pos)
+		{
+			if (Distances[pos] == 0) continue;
+			Keys[pos].hash = map.Keys[pos].hash;
+			traits::construct(&Keys[pos].key, traits::get_view(map.Keys[pos].key, map.arena), arena);
+			new (Values + pos) Value(map.Values[pos]);
+		}
+		count = map.count;
+	}
+
+	// move constructor
+	RobinHoodMap(RobinHoodMap && map): arena(std::move(map.arena)), seed(map.seed), hasher(map.hasher), equal(map.equal)
+	{
+		Distances = map.Distances;
+		Keys = map.Keys;
+		Values = map.Values;
+		capacity = map.capacity;
+		count = map.count;
+		shift = map.shift;
+
+		map.Distances = nullptr;
+		map.Keys = nullptr;
+		map.Values = nullptr;
+		map.capacity = map.count = 0;
+	}
+
+	// copy/move assignment utilizing copy/move constructor by taking argument as value
+	RobinHoodMap & operator=(RobinHoodMap map)
+	{
+		swap(Distances, map.Distances);
+		swap(Keys, map.Keys);
+		swap(Values, map.Values);
+		swap(capacity, map.capacity);
+		swap(count, map.count);
+		swap(shift, map.shift);
+		swap(arena, map.arena);
+		swap(seed, map.seed);
+		swap(hasher, map.hasher);
+		swap(equal, map.equal);
+		// map going out of scope will destruct old RobinHoodMap's object's data
+		return *this;
+	}
+
+	~RobinHoodMap()
+	{
+		// call destructor manually on all objects, since allocation and construction is done separately
+		if (Distances != nullptr) destructInternalData();
+		free(Distances);
+		free(Keys);
+		free(Values);
+		capacity = count = 0;
+	}
+
+	inline s64 size() const { return count; }
+	inline bool isEmpty() const { return count == 0; }
+
+	// returns histogram of probe lengths: element at index d is amount of entries
+	// placed d slots past their home slot, comparable with HashMap::probe_histogram
+	Array<s64> probe_histogram() const
+	{
+		Array<s64> histogram;
+		for (s64 pos = 0; pos < capacity; ++pos)
+		{
+			if (Distances[pos] == 0) continue;
+			const s64 distance = Distances[pos] - 1;
+			while (histogram.size() <= distance) histogram.insert(0);
+			histogram[distance] += 1;
+		}
+		return histogram;
+	}
+
+
+	void insert(key_view key, Value value)
+	{
+		const u64 hash = hash_key(key);
+		s64 pos = key_position(key, hash);
+		if (pos != -1)
+		{
+			Values[pos] = std::move(value);
+			return;
+		}
+		pos = claim_slot(key, hash);
+		new (Values + pos) Value(std::move(value));
+	}
+
+	// usage: if (map.contains(key)) ...
+	bool contains(key_view key) const
+	{
+		return key_position(key, hash_key(key)) != -1;
+	}
+
+	// safe usage: if (map.contains(key)) value = map.get(key);
+	// if we are sure that key is present, we can ignore contains check
+	Value get(key_view key) const
+	{
+		const s64 pos = key_position(key, hash_key(key));
+		if (pos == -1)
+			ERROR("RobinHoodMap: key is not in a map, before getting a value associated with a key, use map.contains(key) to verify that key:value pair is in a map");
+		return Values[pos];
+	}
+
+	// usage: map[key]
+	// get and set/insert element through [] operator
+	// if key is present, reference of value associated with key is returned
+	// if not present, a new entry is created for that key with default Value
+	Value & operator[](key_view key)
+	{
+		const u64 hash = hash_key(key);
+		s64 pos = key_position(key, hash);
+		if (pos == -1)
+		{
+			pos = claim_slot(key, hash);
+			new (Values + pos) Value();
+		}
+		return Values[pos];
+	}
+
+	// usage: map.remove(key);
+	void remove(key_view key)
+	{
+		s64 pos = key_position(key, hash_key(key));
+		if (pos == -1) return; // no element to remove
+
+		traits::destroy(Keys[pos].key, arena);
+		Values[pos].~Value();
+		--count;
+
+		// backward shift: following entries, which are not at their home slot, move one slot closer to it
+		for (s64 next_pos = next(pos); Distances[next_pos] > 1; next_pos = next(next_pos))
+		{
+			move_entry(pos, next_pos, Distances[next_pos] - 1u);
+			pos = next_pos;
+		}
+		Distances[pos] = 0;
+
+		if (count > INITIAL_CAPACITY && count * 8 <= capacity) resize(capacity / 2);
+	}
+};
+
+
+#endif
@@ -3,14 +3,20 @@
 
 #include <iostream>
 #include <iomanip>
+#include <type_traits> // is_trivially_destructible
+#include "Allocator.h"
 #include "Array.h"
 #include "Queue.h"
 #include "utility.h"
 #include "mat.h"
 
 
-// Set implemented as Binary Search Tree
-template <typename type, typename compareType = compare_to<type>>
+// Set implemented as AVL tree (self-balancing Binary Search Tree)
+// heights of every node's subtrees differ by at most 1, so tree height stays under 1.45 * log2(n)
+// no matter the insertion order, which makes insert, remove and contains O(log n) in the worst case
+// nodes are allocated through allocatorType policy (see Allocator.h), PoolAllocator reuses freed nodes
+// and releases the whole tree at once
+template <typename type, typename compareType = compare_to<type>, typename allocatorType = heap_allocator>
 class Set
 {
 	struct Node
@@ -19,15 +25,27 @@ class Set
 		Node* parent;
 		Node* left;
 		Node* right;
+		s32 height; // of the subtree rooted at this node, leaf has height 0
+		s64 size; // amount of nodes in the subtree rooted at this node, used by order statistics
 
-		Node(const type & value, Node* parent = nullptr, Node* left = nullptr, Node* right = nullptr) :
-			value(value), parent(parent), left(left), right(right) { /* empty */ }
+		Node(const type & value, Node* parent = nullptr, Node* left = nullptr, Node* right = nullptr, s32 height = 0, s64 size = 1) :
+			value(value), parent(parent), left(left), right(right), height(height), size(size) { /* empty */ }
 	};
 
 	Node* root;
 	// returns 1 if 1st element is bigger than 2nd, 0 if equal, -1 if 2nd is bigger than 1st
 	compareType compare;
 	s64 nodeCount; // size of Set
+	allocatorType allocator; // every node of this tree comes from it
+
+	template <typename... Args>
+	Node* createNode(Args&&... args) { return new (allocator.allocate(sizeof(Node))) Node(std::forward<Args>(args)...); }
+
+	void destroyNode(Node* node)
+	{
+		node->~Node();
+		allocator.deallocate(node, sizeof(Node));
+	}
 
 	static Node* findNode(Node* tree, const type & value, const compareType & compare)
 	{
@@ -81,12 +99,104 @@ class Set
 		return tree->parent;
 	}
 
+	static s32 heightOf(const Node* tree) { return tree == nullptr ? -1 : tree->height; }
+	static s64 sizeOf(const Node* tree) { return tree == nullptr ? 0 : tree->size; }
+
+	static void updateSize(Node* tree) { tree->size = sizeOf(tree->left) + sizeOf(tree->right) + 1; }
+
+	// recomputes height and size from children
+	static void updateNode(Node* tree)
+	{
+		s32 left_height = heightOf(tree->left);
+		s32 right_height = heightOf(tree->right);
+		tree->height = (left_height > right_height ? left_height : right_height) + 1;
+		updateSize(tree);
+	}
+
+	// fixes sizes on the path from tree up to root after a node was added or removed below tree
+	// rebalancing may stop early, sizes of all ancestors change though
+	static void updateSizesUpwards(Node* tree)
+	{
+		for (; tree != nullptr; tree = tree->parent) updateSize(tree);
+	}
+
+	// makes parent (root if parent is nullptr) point to substitute instead of child
+	void replaceChild(Node* parent, Node* child, Node* substitute)
+	{
+		if (parent == nullptr) root = substitute;
+		else if (parent->left == child) parent->left = substitute;
+		else parent->right = substitute;
+	}
+
+	// tree's right child takes its place, tree becomes its left child, returns new subtree root
+	Node* rotateLeft(Node* tree)
+	{
+		Node* pivot = tree->right;
+		tree->right = pivot->left;
+		if (pivot->left != nullptr) pivot->left->parent = tree;
+		pivot->parent = tree->parent;
+		replaceChild(tree->parent, tree, pivot);
+		pivot->left = tree;
+		tree->parent = pivot;
+		updateNode(tree);
+		updateNode(pivot);
+		return pivot;
+	}
+
+	// tree's left child takes its place, tree becomes its right child, returns new subtree root
+	Node* rotateRight(Node* tree)
+	{
+		Node* pivot = tree->left;
+		tree->left = pivot->right;
+		if (pivot->right != nullptr) pivot->right->parent = tree;
+		pivot->parent = tree->parent;
+		replaceChild(tree->parent, tree, pivot);
+		pivot->right = tree;
+		tree->parent = pivot;
+		updateNode(tree);
+		updateNode(pivot);
+		return pivot;
+	}
+
+	// restores balance of a node whose subtrees differ in height by at most 2, returns new subtree root
+	Node* balanceNode(Node* tree)
+	{
+		updateNode(tree);
+		s32 balance = heightOf(tree->left) - heightOf(tree->right);
+		if (balance > 1)
+		{
+			// left-right case is turned into left-left case first
+			if (heightOf(tree->left->left) < heightOf(tree->left->right)) rotateLeft(tree->left);
+			return rotateRight(tree);
+		}
+		if (balance < -1)
+		{
+			// right-left case is turned into right-right case first
+			if (heightOf(tree->right->right) < heightOf(tree->right->left)) rotateRight(tree->right);
+			return rotateLeft(tree);
+		}
+		return tree;
+	}
+
+	// rebalances nodes on the path from tree up to root after insertion or removal below tree
+	// stops as soon as a subtree keeps its previous height, nodes above it can't be affected
+	void rebalanceUpwards(Node* tree)
+	{
+		while (tree != nullptr)
+		{
+			s32 old_height = tree->height;
+			tree = balanceNode(tree);
+			if (tree->height == old_height) break;
+			tree = tree->parent;
+		}
+	}
+
 	// returns true if value was not present in container, false otherwhise
 	bool insertNode(const type & value)
 	{
 		if (root == nullptr)
 		{
-			root = new Node(value);
+			root = createNode(value);
 			nodeCount += 1;
 			return true;
 		}
@@ -104,10 +214,12 @@ class Set
 			else 				return false;
 		}
 
-		if (cmp < 0) 		parent->left = new Node(value, parent);
-		else if (cmp > 0) 	parent->right = new Node(value, parent);
+		if (cmp < 0) 		parent->left = createNode(value, parent);
+		else if (cmp > 0) 	parent->right = createNode(value, parent);
 		else return false;
 		nodeCount += 1;
+		updateSizesUpwards(parent);
+		rebalanceUpwards(parent);
 		return true;
 	}
 
@@ -131,14 +243,18 @@ class Set
 			if (substitute != nullptr) substitute->parent = tree->parent;
 		};
 
+		// lowest node whose subtree lost a node, balance is restored from it upwards
+		Node* changed = tree->parent;
 		if (tree->left == nullptr && tree->right == nullptr) transplantNode(tree, nullptr);
 		else if (tree->left == nullptr) transplantNode(tree, tree->right);
 		else if (tree->right == nullptr) transplantNode(tree, tree->left);
 		else
 		{
 			Node* next_larger = successor(tree);
+			changed = next_larger;
 			if (tree->right != next_larger)
 			{
+				changed = next_larger->parent;
 				transplantNode(next_larger, next_larger->right);
 				next_larger->right = tree->right;
 				tree->right->parent = next_larger;
@@ -146,38 +262,251 @@ class Set
 			transplantNode(tree, next_larger);
 			next_larger->left = tree->left;
 			tree->left->parent = next_larger;
+			next_larger->height = tree->height;
 		}
-		delete tree; nodeCount -= 1; return true;
+		destroyNode(tree); nodeCount -= 1;
+		updateSizesUpwards(changed);
+		rebalanceUpwards(changed);
+		return true;
 	}
 
 	// side effect if tree was not empty:
 	// after method call: root instance variable points to deallocated memory
 	// after method call: nodeCount instance variable is not zero
-	static void clearTree(Node* tree)
+	// allocator releasing everything at once only needs values destructed, memory isn't given back node by node
+	void clearTree(Node* tree)
 	{
 		if (tree == nullptr) return;
 
 		clearTree(tree->left);
 		clearTree(tree->right);
 
-		delete tree;
+		if (allocatorType::BULK_RELEASE) tree->~Node();
+		else destroyNode(tree);
 	}
 
 	// creates a copy of the provided tree and returns new tree's root
-	static Node* copyTree(Node* tree, Node* parent = nullptr)
+	Node* copyTree(Node* tree, Node* parent = nullptr)
 	{
 		if (tree == nullptr) return nullptr;
 
-		Node* left = copyTree(tree->left, tree);
-		Node* right = copyTree(tree->right, tree);
+		// children have to point to the copy, not to the original node
+		Node* copy = createNode(tree->value, parent, nullptr, nullptr, tree->height, tree->size);
+		copy->left = copyTree(tree->left, copy);
+		copy->right = copyTree(tree->right, copy);
+		return copy;
+	}
+
+	// frees every node of a detached tree, unlike clearTree memory goes back to the allocator one node at a time
+	void destroyTree(Node* tree)
+	{
+		if (tree == nullptr) return;
+
+		destroyTree(tree->left);
+		destroyTree(tree->right);
+		destroyNode(tree);
+	}
+
+	// SPLIT AND JOIN
+	// work on detached trees, whose roots have no parent, root member is overwritten by rotations at their tops
+	// and has to be set by the caller afterwards
 
-		return new Node(tree->value, parent, left, right);
+	// detaches and returns tree's child
+	static Node* detachChild(Node* child)
+	{
+		if (child != nullptr) child->parent = nullptr;
+		return child;
 	}
 
+	// rebalances every node from tree up to the top of its tree, returns the top
+	Node* rebalanceToTop(Node* tree)
+	{
+		Node* top = nullptr;
+		for (; tree != nullptr; tree = tree->parent)
+		{
+			tree = balanceNode(tree);
+			top = tree;
+		}
+		return top;
+	}
+
+	// joins left tree, middle node and right tree, values of left < middle < values of right, O(|height difference|)
+	// middle is hung in the taller tree at the first node of its outer spine low enough to balance with the other tree
+	Node* joinTrees(Node* left, Node* middle, Node* right)
+	{
+		if (heightOf(left) > heightOf(right) + 1)
+		{
+			Node* parent = nullptr;
+			Node* low = left;
+			while (heightOf(low) > heightOf(right) + 1)
+			{
+				parent = low;
+				low = low->right;
+			}
+			middle->left = low;
+			middle->right = right;
+			if (low != nullptr) low->parent = middle;
+			if (right != nullptr) right->parent = middle;
+			middle->parent = parent;
+			parent->right = middle;
+			updateNode(middle);
+			return rebalanceToTop(parent);
+		}
+		if (heightOf(right) > heightOf(left) + 1)
+		{
+			Node* parent = nullptr;
+			Node* low = right;
+			while (heightOf(low) > heightOf(left) + 1)
+			{
+				parent = low;
+				low = low->left;
+			}
+			middle->left = left;
+			middle->right = low;
+			if (left != nullptr) left->parent = middle;
+			if (low != nullptr) low->parent = middle;
+			middle->parent = parent;
+			parent->left = middle;
+			updateNode(middle);
+			return rebalanceToTop(parent);
+		}
+		middle->left = left;
+		middle->right = right;
+		if (left != nullptr) left->parent = middle;
+		if (right != nullptr) right->parent = middle;
+		middle->parent = nullptr;
+		updateNode(middle);
+		return middle;
+	}
+
+	// splits tree into values going left (smaller than value, or not larger if equal_left is true) and the rest
+	// joins along the search path cost O(log n) in total
+	void splitTree(Node* tree, const type & value, bool equal_left, Node* & left, Node* & right)
+	{
+		if (tree == nullptr)
+		{
+			left = right = nullptr;
+			return;
+		}
+
+		Node* tree_left = detachChild(tree->left);
+		Node* tree_right = detachChild(tree->right);
+		int cmp = compare(tree->value, value);
+		if (cmp < 0 || (cmp == 0 && equal_left))
+		{
+			Node* right_left;
+			splitTree(tree_right, value, equal_left, right_left, right);
+			left = joinTrees(tree_left, tree, right_left);
+		}
+		else
+		{
+			Node* left_right;
+			splitTree(tree_left, value, equal_left, left, left_right);
+			right = joinTrees(left_right, tree, tree_right);
+		}
+	}
+
+	// detaches largest node of non empty tree into last, returns tree of the remaining nodes
+	Node* splitLast(Node* tree, Node* & last)
+	{
+		Node* tree_left = detachChild(tree->left);
+		if (tree->right == nullptr)
+		{
+			last = tree;
+			return tree_left;
+		}
+		Node* rest = splitLast(detachChild(tree->right), last);
+		return joinTrees(tree_left, tree, rest);
+	}
+
+	// joins two trees, values of left < values of right
+	Node* joinTrees(Node* left, Node* right)
+	{
+		if (left == nullptr) return right;
+		if (right == nullptr) return left;
+		Node* last;
+		left = splitLast(left, last);
+		return joinTrees(left, last, right);
+	}
+
+	enum class mergeKind { UNION, INTERSECTION, DIFFERENCE };
+
+	// walks both trees in order at once and returns nodes, whose values belong to the result, in sorted order
+	// value present in both trees is taken from lhs
+	static Array<const Node*> mergeNodes(Node* lhs, Node* rhs, mergeKind kind, const compareType & compare)
+	{
+		Array<const Node*> result;
+		lhs = findMin(lhs);
+		rhs = findMin(rhs);
+		while (lhs != nullptr && rhs != nullptr)
+		{
+			int cmp = compare(lhs->value, rhs->value);
+			if (cmp < 0)
+			{
+				if (kind != mergeKind::INTERSECTION) result.insert(lhs);
+				lhs = successor(lhs);
+			}
+			else if (cmp > 0)
+			{
+				if (kind == mergeKind::UNION) result.insert(rhs);
+				rhs = successor(rhs);
+			}
+			else
+			{
+				if (kind != mergeKind::DIFFERENCE) result.insert(lhs);
+				lhs = successor(lhs);
+				rhs = successor(rhs);
+			}
+		}
+		// values left in only one of the trees
+		if (kind != mergeKind::INTERSECTION)
+			for (; lhs != nullptr; lhs = successor(lhs)) result.insert(lhs);
+		if (kind == mergeKind::UNION)
+			for (; rhs != nullptr; rhs = successor(rhs)) result.insert(rhs);
+		return result;
+	}
+
+	// sorted sequences tree can be built from
+	static const type & valueAt(const Array<const Node*> & nodes, s64 index) { return nodes[index]->value; }
+	static const type & valueAt(const Array<type> & values, s64 index) { return values[index]; }
+
+	// builds perfectly balanced tree out of copies of sorted values within [start, end), returns its root
+	// halves differ in size by at most 1, so their heights differ by at most 1 as well
+	// if memory is given, node of value at index i is placed at memory + i * stride, so nodes lie in order
+	template <typename sequenceType>
+	Node* buildTree(const sequenceType & values, s64 start, s64 end, char* memory, u64 stride, Node* parent = nullptr)
+	{
+		if (start >= end) return nullptr;
+
+		s64 middle = start + (end - start) / 2;
+		Node* tree = memory != nullptr ? new (memory + middle * stride) Node(valueAt(values, middle), parent) :
+			createNode(valueAt(values, middle), parent);
+		tree->left = buildTree(values, start, middle, memory, stride, tree);
+		tree->right = buildTree(values, middle + 1, end, memory, stride, tree);
+		updateNode(tree);
+		return tree;
+	}
+
+	// returns set containing sorted values, all nodes are allocated at once if allocator can do that
+	template <typename sequenceType>
+	static Set fromSortedSequence(const sequenceType & values, s64 count)
+	{
+		Set set;
+		u64 stride = sizeof(Node);
+		char* memory = (char*)set.allocator.allocate_bulk(count, sizeof(Node), stride);
+		set.root = set.buildTree(values, 0, count, memory, stride);
+		set.nodeCount = count;
+		return set;
+	}
+
+	static Set fromSortedNodes(const Array<const Node*> & nodes) { return fromSortedSequence(nodes, nodes.size()); }
+
 public:
 
 	class iterator : public std::iterator<std::input_iterator_tag, type>
 	{
+		friend class Set;
+
 		const Set* set;
 		// position pointing to the node containing value to return
 		// starting from min element (findMin)
@@ -185,6 +514,9 @@ public:
 		// position pointing to the next node
 		// usefull if you remove a node while iterating - still have pointer to the next one
 		Node* next_pos;
+
+		// iterator starting at given node, nullptr gives end iterator
+		iterator(const Set* set, Node* pos) : set(set), pos(pos), next_pos(successor(pos)) { /* empty */ }
 	public:
 		// default non usable constructor, which returns invalid iterator
 		iterator() : set(nullptr), pos(nullptr), next_pos(nullptr) { /* empty */ }
@@ -234,45 +566,39 @@ public:
 	};
 
 	// constructor
-	Set(): root(nullptr), compare(), nodeCount(0) { /* empty */ }
+	Set(): root(nullptr), compare(), nodeCount(0), allocator() { /* empty */ }
 
 
 	// uniform initialization -  Set<float> set = { 2.3, 2.4 ... }
 	Set(const std::initializer_list<type> & il): Set()
-		{ for (auto & el : il) this->insert(el); }
+	{
+		Array<type> values;
+		values.reserve(il.size());
+		for (auto & el : il) values.insert(el);
+		*this = fromUnsorted(values);
+	}
 
-	// copy constructor
-	Set(const Set<type> & set)
+	// copy constructor, copy gets its own allocator
+	Set(const Set & set): root(nullptr), compare(set.compare), nodeCount(set.nodeCount), allocator()
 	{
 		this->root = copyTree(set.root);
-		this->nodeCount = set.nodeCount;
-		this->compare = set.compare;
 	}
 
-	// move constructor
-	Set(Set<type> && set)
+	// move constructor, nodes stay in the allocator they came from, so it moves along
+	Set(Set && set): root(set.root), compare(set.compare), nodeCount(set.nodeCount), allocator(std::move(set.allocator))
 	{
-		this->root = set.root;
-		this->nodeCount = set.nodeCount;
-		this->compare = set.compare;
-
 		set.root = nullptr;
 		set.nodeCount = 0;
 	}
 
 	// copy/move assignment
-	Set & operator=(Set<type> set)
+	Set & operator=(Set set)
 	{
-		// swap
-		Node* root_temp = this->root;
-		s64 nodeCount_temp = this->nodeCount;
-
-		this->root = set.root;
-		this->nodeCount = set.nodeCount;
-		this->compare = set.compare;
-
-		set.root = root_temp;
-		set.nodeCount = nodeCount_temp;
+		// qualified, so that std::swap isn't found through type's namespace as well
+		::swap(this->root, set.root);
+		::swap(this->nodeCount, set.nodeCount);
+		::swap(this->compare, set.compare);
+		::swap(this->allocator, set.allocator);
 		// set going out of scope will destruct old tree
 		return *this;
 	}
@@ -285,7 +611,14 @@ public:
 	bool insert(const type & value) { return insertNode(value); }
 	bool contains(const type & value) const { return findNode(root, value, compare) != nullptr; }
 	bool remove(const type & value) { return removeNode(findNode(root, value, compare)); }
-	void clear() { clearTree(root); nodeCount = 0; root = nullptr; }
+	void clear()
+	{
+		// values without destructor in a pool don't need the tree to be walked at all
+		if (!allocatorType::BULK_RELEASE || !std::is_trivially_destructible<type>::value) clearTree(root);
+		allocator.release();
+		nodeCount = 0;
+		root = nullptr;
+	}
 	inline s64 size() const { return nodeCount; }
 	inline bool isEmpty() const { return nodeCount == 0; }
 	iterator begin() const { return iterator(this); }
@@ -293,117 +626,281 @@ public:
 
 
 
-	// SET OPERATIONS
+	// BULK CONSTRUCTION
 
-	// set union
-	Set<type> operator+(const Set<type> & rhs) const
+	// builds perfectly balanced tree in O(n) out of values sorted according to compareType, equal neighbours are
+	// stored once, with PoolAllocator all nodes come from one contiguous block and lie in sorted order
+	static Set fromSorted(const Array<type> & values)
 	{
-		Set<type> set(*this);
-		for (type value : rhs)
-			set.insert(value);
-		return set;
+		const compareType compare = compareType();
+		s64 unique = values.size() > 0 ? 1 : 0;
+		for (s64 i = 1; i < values.size(); ++i)
+		{
+			int cmp = compare(values[i - 1], values[i]);
+			if (cmp > 0) ERROR("Set: values passed to fromSorted are not sorted, value at %lld is smaller than previous one", i);
+			if (cmp < 0) unique += 1;
+		}
+		if (unique == values.size()) return fromSortedSequence(values, values.size());
+
+		Array<type> distinct;
+		distinct.reserve(unique);
+		for (s64 i = 0; i < values.size(); ++i)
+			if (i == 0 || compare(values[i - 1], values[i]) != 0) distinct.insert(values[i]);
+		return fromSortedSequence(distinct, distinct.size());
 	}
 
-	Set<type> operator+(const type & value) const
+	// sorts copy of values with Array::sort and builds tree out of it, O(n log n)
+	static Set fromUnsorted(const Array<type> & values)
 	{
-		Set<type> set(*this);
-		set.insert(value);
-		return set;
+		Array<type> sorted(values);
+		const compareType compare = compareType();
+		sorted.sort([&compare](const type & lhs, const type & rhs) { return compare(lhs, rhs) < 0; });
+		return fromSorted(sorted);
 	}
 
-	Set<type> & operator+=(const Set<type> & rhs)
+
+
+	// RANGE OPERATIONS
+
+	// calls fn with every value within [low, high] in sorted order, O(log n + k)
+	// in-order walk keeps the path in a local stack instead of climbing parent pointers for every value
+	template <typename functionType>
+	void for_each_in_range(const type & low, const type & high, functionType fn) const
 	{
-		for (type value : rhs)
-			this->insert(value);
-		return *this;
+		// AVL tree of 2^63 nodes is less than 92 levels high
+		Node* path[96];
+		s32 depth = 0;
+
+		// pushes nodes not smaller than low on the way to the smallest of them
+		auto descend = [&](Node* tree)
+		{
+			while (tree != nullptr)
+			{
+				if (compare(tree->value, low) < 0) tree = tree->right;
+				else
+				{
+					path[depth++] = tree;
+					tree = tree->left;
+				}
+			}
+		};
+
+		descend(root);
+		while (depth > 0)
+		{
+			Node* tree = path[--depth];
+			if (compare(tree->value, high) > 0) return;
+			fn(tree->value);
+			descend(tree->right);
+		}
 	}
 
-	Set<type> operator+=(const type & value)
+	// removes every value within [low, high] and returns their amount, O(log n + k)
+	// tree is split into values below, within and above the range, outer parts are joined back together
+	s64 erase_range(const type & low, const type & high)
 	{
-		this->insert(value);
-		return *this;
+		if (compare(low, high) > 0) return 0;
+
+		Node* below; Node* rest; Node* within; Node* above;
+		splitTree(root, low, /*equal_left*/ false, below, rest);
+		splitTree(rest, high, /*equal_left*/ true, within, above);
+		s64 erased = sizeOf(within);
+		destroyTree(within);
+		root = joinTrees(below, above);
+		nodeCount -= erased;
+		return erased;
 	}
 
-	// set intersection
-	Set<type> operator*(const Set<type> & rhs) const
+
+
+	// ORDER STATISTICS
+	// every node knows size of its subtree, so these descend the tree once, O(log n)
+
+	// returns amount of values smaller than value
+	s64 rank(const type & value) const
 	{
-		Set<type> set;
-		for (type value : rhs)
+		s64 smaller = 0;
+		for (Node* tree = root; tree != nullptr;)
 		{
-			if (this->contains(value))
-				set.insert(value);
+			if (compare(value, tree->value) <= 0) tree = tree->left;
+			else
+			{
+				smaller += sizeOf(tree->left) + 1;
+				tree = tree->right;
+			}
 		}
-		return set;
+		return smaller;
 	}
 
-	Set<type> & operator*=(const Set<type> & rhs)
+	// returns k-th smallest value, counting from 0
+	type select(s64 k) const
 	{
-		Array<type> toRemove;
-		for (type value : *this)
+		if (k < 0 || k >= nodeCount) ERROR("Set: select position %lld out of range, set contains %lld values", k, nodeCount);
+		Node* tree = root;
+		while (true)
 		{
-			if (!rhs.contains(value))
-				toRemove.insert(value);
+			s64 left_size = sizeOf(tree->left);
+			if (k < left_size) tree = tree->left;
+			else if (k == left_size) return tree->value;
+			else
+			{
+				k -= left_size + 1;
+				tree = tree->right;
+			}
 		}
-		for (type value : toRemove)
-			this->remove(value);
-		return *this;
 	}
 
-	// set difference
-	Set<type> operator-(const Set<type> & rhs) const
+	// returns amount of values within [low, high], both ends included
+	s64 count_range(const type & low, const type & high) const
+	{
+		if (compare(low, high) > 0) return 0;
+		return (nodeCount - rank_above(high)) - rank(low);
+	}
+
+	// returns iterator to the first value not smaller than value, end() if there is none
+	iterator lower_bound(const type & value) const
+	{
+		Node* bound = nullptr;
+		for (Node* tree = root; tree != nullptr;)
+		{
+			if (compare(tree->value, value) >= 0)
+			{
+				bound = tree;
+				tree = tree->left;
+			}
+			else tree = tree->right;
+		}
+		return iterator(this, bound);
+	}
+
+	// returns iterator to the first value larger than value, end() if there is none
+	iterator upper_bound(const type & value) const
+	{
+		Node* bound = nullptr;
+		for (Node* tree = root; tree != nullptr;)
+		{
+			if (compare(tree->value, value) > 0)
+			{
+				bound = tree;
+				tree = tree->left;
+			}
+			else tree = tree->right;
+		}
+		return iterator(this, bound);
+	}
+
+private:
+
+	// returns amount of values larger than value
+	s64 rank_above(const type & value) const
 	{
-		Set<type> set;
-		for (type value : *this)
+		s64 larger = 0;
+		for (Node* tree = root; tree != nullptr;)
 		{
-			if (!rhs.contains(value))
-				set.insert(value);
+			if (compare(value, tree->value) >= 0) tree = tree->right;
+			else
+			{
+				larger += sizeOf(tree->right) + 1;
+				tree = tree->left;
+			}
 		}
+		return larger;
+	}
+
+public:
+
+
+
+	// SET OPERATIONS
+	// set with set operations walk both trees in order at once (merge), so they take O(n + m)
+	// and result tree is built bottom up from sorted output, perfectly balanced and without any rotations
+
+	// set union
+	Set operator+(const Set & rhs) const { return fromSortedNodes(mergeNodes(root, rhs.root, mergeKind::UNION, compare)); }
+
+	Set operator+(const type & value) const
+	{
+		Set set(*this);
+		set.insert(value);
 		return set;
 	}
 
-	Set<type> operator-(const type & value) const
+	Set & operator+=(const Set & rhs)
 	{
-		Set<type> set(*this);
+		*this = *this + rhs;
+		return *this;
+	}
+
+	Set operator+=(const type & value)
+	{
+		this->insert(value);
+		return *this;
+	}
+
+	// set intersection
+	Set operator*(const Set & rhs) const { return fromSortedNodes(mergeNodes(root, rhs.root, mergeKind::INTERSECTION, compare)); }
+
+	Set & operator*=(const Set & rhs)
+	{
+		*this = *this * rhs;
+		return *this;
+	}
+
+	// set difference
+	Set operator-(const Set & rhs) const { return fromSortedNodes(mergeNodes(root, rhs.root, mergeKind::DIFFERENCE, compare)); }
+
+	Set operator-(const type & value) const
+	{
+		Set set(*this);
 		set.remove(value);
 		return set;
 	}
 
-	Set<type> & operator-=(const Set<type> & rhs)
+	Set & operator-=(const Set & rhs)
 	{
-		for (type value : rhs)
-			this->remove(value);
+		*this = *this - rhs;
 		return *this;
 	}
 
-	Set<type> & operator-=(const type & value)
+	Set & operator-=(const type & value)
 	{
 		this->remove(value);
 		return *this;
 	}
 
 
-	bool isSubsetOf(const Set<type> & rhs)  const
+	// every value of this set has to be matched while walking rhs in order
+	bool isSubsetOf(const Set & rhs)  const
 	{
-		for (const type & value : *this)
+		if (this->size() > rhs.size()) return false;
+		Node* lhs_pos = findMin(this->root);
+		Node* rhs_pos = findMin(rhs.root);
+		while (lhs_pos != nullptr)
 		{
-			if (!rhs.contains(value)) return false;
+			// rhs has fewer values left than lhs, some of them can't be matched
+			if (rhs_pos == nullptr) return false;
+			int cmp = compare(lhs_pos->value, rhs_pos->value);
+			if (cmp < 0) return false;
+			if (cmp == 0) lhs_pos = successor(lhs_pos);
+			rhs_pos = successor(rhs_pos);
 		}
 		return true;
 	}
 
-	bool isSupersetOf(const Set<type> & rhs) const
+	bool isSupersetOf(const Set & rhs) const { return rhs.isSubsetOf(*this); }
+
+	// equal sets have equal sizes and the same values in the same order
+	bool operator==(const Set & rhs) const
 	{
-		for (const type & value : rhs)
-		{
-			if (!this->contains(value)) return false;
-		}
+		if (this->size() != rhs.size()) return false;
+		Node* lhs_pos = findMin(this->root);
+		Node* rhs_pos = findMin(rhs.root);
+		for (; lhs_pos != nullptr; lhs_pos = successor(lhs_pos), rhs_pos = successor(rhs_pos))
+			if (compare(lhs_pos->value, rhs_pos->value) != 0) return false;
 		return true;
 	}
 
-	bool operator==(const Set<type> & rhs) const
-	{ return this->isSubsetOf(rhs) && rhs.isSubsetOf(*this); }
-
-	bool operator!=(const Set<type> & rhs) const { return !(*this == rhs); }
+	bool operator!=(const Set & rhs) const { return !(*this == rhs); }
 
 
 
@@ -423,7 +920,8 @@ public:
 		return max_height + 1;
 	}
 
-	int height() const { bool unused = true; return heightWrapper(root, unused); }
+	// kept in every node, so no traversal is needed
+	int height() const { return heightOf(root); }
 
 	bool isBalanced() const
 	{
@@ -656,7 +1154,7 @@ public:
 
 	// prints tree visualization
 	// those objects have to implement << operator in order to work
-	friend std::ostream & operator<<(std::ostream & os, const Set<type> & set)
+	friend std::ostream & operator<<(std::ostream & os, const Set & set)
 	{
 		printTree(set.root, os);
 		return os;
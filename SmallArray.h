@@ -0,0 +1,329 @@
+#ifndef _smallarray_h
+#define _smallarray_h
+
+#include <iostream>
+#include <cstdlib> // malloc, realloc, free
+#include <cstring> // memcpy
+#include <type_traits> // is_trivially_copyable, integral_constant
+#include "Array.h" // ARRAY_GROWTH_FACTOR, ArrayView, ArraySpan
+#include "sorting.h" // quickSort
+#include "utility.h"
+
+
+// Array keeping up to N elements inline, inside the object itself, so small arrays never touch the heap
+// past N elements it moves them to heap memory growing by ARRAY_GROWTH_FACTOR, just like Array
+// heap memory is kept until the array is destructed or shrink_to_fit brings the elements back inline
+template <typename type, s64 N>
+class SmallArray
+{
+	static_assert(N > 0, "SmallArray: inline capacity has to be positive");
+
+	s64 capacity; // N while inline, allocated size otherwise
+	s64 count; // effective size
+	type *elements; // points to inline_elements or heap memory
+	alignas(type) char inline_elements[N * sizeof(type)];
+
+	// types which can be copied bytewise are moved by memcpy and realloc
+	static const bool RELOCATABLE = std::is_trivially_copyable<type>::value;
+
+	type* inlineElements() { return (type*)inline_elements; }
+	bool isInline() const { return elements == (const type*)inline_elements; }
+
+	// destructs all objects within container
+	void destructInternalData()
+	{
+		for (s64 i = 0; i < count; ++i) elements[i].~type();
+	}
+
+	// tag picking memcpy / realloc overloads below
+	typedef std::integral_constant<bool, RELOCATABLE> relocatable;
+
+	// moves count elements from source to uninitialized destination, source objects are destructed
+	static void relocate(type* destination, type* source, s64 count, std::true_type)
+	{
+		if (count > 0) memcpy(destination, source, count * sizeof(type));
+	}
+
+	static void relocate(type* destination, type* source, s64 count, std::false_type)
+	{
+		for (s64 i = 0; i < count; ++i)
+		{
+			new(destination + i) type(std::move(source[i]));
+			source[i].~type();
+		}
+	}
+
+	static void relocate(type* destination, type* source, s64 count) { relocate(destination, source, count, relocatable()); }
+
+	// copies count elements from source to uninitialized destination
+	static void copyElements(type* destination, const type* source, s64 count, std::true_type)
+	{
+		if (count > 0) memcpy(destination, source, count * sizeof(type));
+	}
+
+	static void copyElements(type* destination, const type* source, s64 count, std::false_type)
+	{
+		for (s64 i = 0; i < count; ++i) new(destination + i) type(source[i]);
+	}
+
+	// heap elements copied bytewise are grown in place by realloc, returns nullptr if they can't be
+	type* resizeHeap(s64 capacity, std::true_type)
+	{
+		if (isInline()) return nullptr;
+		type* new_elements = (type*) realloc(elements, capacity * sizeof(type));
+		if (new_elements == nullptr) ERROR("Failed to allocate memory to expand SmallArray object");
+		return new_elements;
+	}
+
+	type* resizeHeap(s64, std::false_type) { return nullptr; }
+
+	// moves elements to memory of given capacity, which can't be lower than count, N or less brings them inline
+	void reallocate(s64 capacity)
+	{
+		if (capacity <= N)
+		{
+			if (isInline()) return;
+			relocate(inlineElements(), elements, count);
+			free(elements);
+			elements = inlineElements();
+			this->capacity = N;
+			return;
+		}
+		if (((capacity * sizeof(type)) / capacity) != sizeof(type))
+			ERROR("SmallArray capacity expansion failed, given capacity * type overflows");
+
+		type* new_elements = resizeHeap(capacity, relocatable());
+		if (new_elements == nullptr)
+		{
+			new_elements = (type*) malloc(capacity * sizeof(type));
+			if (new_elements == nullptr) ERROR("Failed to allocate memory to expand SmallArray object");
+			relocate(new_elements, elements, count);
+			if (!isInline()) free(elements);
+		}
+
+		elements = new_elements;
+		this->capacity = capacity;
+	}
+
+	// default -1 means that capacity grows by ARRAY_GROWTH_FACTOR
+	void expandCapacity(s64 capacity = -1)
+	{
+		if (capacity == -1)
+		{
+			capacity = (s64)(this->capacity * ARRAY_GROWTH_FACTOR);
+			if (capacity <= this->capacity) capacity = this->capacity + 1;
+		}
+		if (capacity > this->capacity) reallocate(capacity);
+	}
+
+	// takes elements of arr, which has to be empty, heap memory is taken over, inline elements are moved one by one
+	void takeOver(SmallArray & arr)
+	{
+		if (arr.isInline())
+		{
+			relocate(elements, arr.elements, arr.count);
+			count = arr.count;
+		}
+		else
+		{
+			elements = arr.elements;
+			capacity = arr.capacity;
+			count = arr.count;
+			arr.elements = arr.inlineElements();
+			arr.capacity = N;
+		}
+		arr.count = 0;
+	}
+
+public:
+
+	// constructor, elements are stored inline until there are more than N of them
+	SmallArray(): capacity(N), count(0), elements(inlineElements()) { /* empty */ }
+
+	// uniform initialization -  SmallArray<float, 4> arr = { 2.3, 2.4 ... }
+	SmallArray(const std::initializer_list<type> & il): SmallArray()
+	{
+		reserve(il.size());
+		for (auto & el : il) new(elements + count++) type(el);
+	}
+
+	~SmallArray()
+	{
+		destructInternalData();
+		count = 0;
+		if (!isInline()) free(elements);
+	}
+
+	// copy constructor, copy gets only as much memory as it needs
+	SmallArray(const SmallArray & arr): SmallArray()
+	{
+		reserve(arr.count);
+		copyElements(elements, arr.elements, arr.count, relocatable());
+		count = arr.count;
+	}
+
+	// move constructor
+	SmallArray(SmallArray && arr): SmallArray() { takeOver(arr); }
+
+	// copy/move assignment utilizing copy/move constructor by taking argument as value
+	// elements can live inline, so they are taken over instead of swapping pointers
+	SmallArray & operator=(SmallArray arr)
+	{
+		destructInternalData();
+		if (!isInline()) free(elements);
+		elements = inlineElements();
+		capacity = N;
+		count = 0;
+		takeOver(arr);
+		return *this;
+	}
+
+	void reserve(s64 capacity)
+	{
+		if (capacity > this->capacity) expandCapacity(capacity);
+	}
+
+	// gives back heap memory not used by elements, moves them back inline if they fit
+	void shrink_to_fit()
+	{
+		if (!isInline() && capacity > count) reallocate(count);
+	}
+
+	// get or set element through [] operator, position is checked only in debug builds (NDEBUG not defined)
+	type & operator[](s64 position) const
+	{
+#ifndef NDEBUG
+		if (position < 0 || position >= count)
+			ERROR("SmallArray (size %lld) can't get element from %lld position - out of range", count, position);
+#endif
+		return elements[position];
+	}
+
+	// same as [] operator, but position is checked in every build
+	type & at(s64 position) const
+	{
+		if (position < 0 || position >= count)
+			ERROR("SmallArray (size %lld) can't get element from %lld position - out of range", count, position);
+		return elements[position];
+	}
+
+	// position is never checked, for inner loops which already keep within bounds
+	type & at_unchecked(s64 position) const { return elements[position]; }
+
+	type* data() { return elements; }
+	const type* data() const { return elements; }
+
+	// non owning views of all elements, invalidated once SmallArray reallocates
+	ArrayView<type> view() const { return ArrayView<type>(elements, count); }
+	ArraySpan<type> span() { return ArraySpan<type>(elements, count); }
+
+	// begin of iterator for auto range based loop
+	type * begin() { return elements; }
+
+	// end of iterator for auto range based loop
+	type * end() { return (elements + count); }
+
+	// insert move type element to the end
+	void insert(type el)
+	{
+		if (count == capacity) expandCapacity();
+		new(elements + count++) type(std::move(el));
+	}
+
+	// insert type element to the specified position
+	void insert(type el, s64 position)
+	{
+		if (position < 0 || position > count)
+			ERROR("SmallArray (size %lld) can't insert element to %lld position - out of range", count, position);
+		if (capacity == count) expandCapacity();
+
+		if (position == count)
+		{
+			new(elements + count++) type(std::move(el));
+			return;
+		}
+
+		new(elements + count) type(std::move(elements[count-1]));
+		for (s64 i = count - 2; i >= position; --i)
+			elements[i + 1] = std::move(elements[i]);
+		elements[position] = std::move(el);
+		count++;
+	}
+
+	// removes type element at specified position
+	// ordered preserves order (default), not ordered moves last element to the place of removal
+	void remove(s64 position, bool ordered = true)
+	{
+		if (position < 0 || position >= count)
+			ERROR("SmallArray (size %lld) can't remove element from %lld position - out of range", count, position);
+
+		if (ordered)
+		{
+			for (s64 i = position; i < count - 1; ++i)
+				elements[i] = std::move(elements[i + 1]);
+		}
+		else elements[position] = std::move(elements[count - 1]);
+
+		elements[--count].~type();
+	}
+
+	// removes last element and returns it
+	type pop()
+	{
+		if (this->count == 0) ERROR("SmallArray is empty container: can't pop element");
+		type result = std::move(this->elements[count-1]);
+		this->remove(count-1);
+		return result;
+	}
+
+	// returns the index of the first element which is equal to given value within start to end (not included)
+	// returns -1 if not found or provided range is not whithin container boundaries
+	template <typename compareType = compare_equal<type>>
+	s64 find(const type & value, s64 start = 0, s64 end = -1, compareType compare = compare_equal<type>())
+	{
+		if (end == -1) end = this->count;
+		if (start < 0 || start >= this->count || end <= start) return -1;
+
+		for (s64 i = start; i < end; ++i)
+			if (compare(elements[i], value)) return i;
+		return -1;
+	}
+
+	template <typename compareType = compare_less<type>>
+	void sort(compareType compare = compare_less<type>())
+	{
+		thread_local Random64 rng;
+		::quickSort(elements, count, rng, compare);
+	}
+
+	// removes all elements, heap memory is kept for reuse
+	void clear()
+	{
+		destructInternalData();
+		count = 0;
+	}
+
+	inline s64 size() const { return count; }
+	inline bool isEmpty() const { return count == 0; }
+
+	bool operator==(const SmallArray & rhs) const
+	{
+		if (this->size() != rhs.size()) return false;
+		for (s64 i = 0; i < count; ++i)
+			if (elements[i] != rhs.elements[i]) return false;
+		return true;
+	}
+
+	bool operator!=(const SmallArray & rhs) const { return !(*this == rhs); }
+
+	// fills output stream with objects info contained in SmallArray
+	friend std::ostream & operator<<(std::ostream & os, const SmallArray & arr)
+	{
+		os << "SmallArray (size " << arr.count << "): ";
+		for (s64 i = 0; i < arr.count; ++i) os << arr.elements[i] << " ";
+		return os;
+	}
+};
+
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef _soaarray_h
+#define _soaarray_h
+
+#include <tuple> // tuple, get, apply, tuple_element
+#include <utility> // index_sequence
+#include "Array.h"
+#include "ArrayView.h"
+#include "sorting.h" // mergeSort
+#include "utility.h"
+
+
+// structure of arrays, records of Fields... are kept as one Array per field (column) instead of one Array of records
+// loop reading one or two fields pulls only their columns through the cache, columns are plain contiguous memory
+// which kernels can access directly through column<I>(), row(i) gives record-like access to all fields at once
+// all columns always have the same size, so they can only be grown or shrunk through SoAArray itself
+template <typename... Fields>
+class SoAArray
+{
+	static_assert(sizeof...(Fields) > 0, "SoAArray: there has to be at least one field");
+
+	std::tuple<Array<Fields>...> columns;
+
+	typedef std::index_sequence_for<Fields...> field_indices;
+
+	template <size_t... I, typename... Values>
+	void insertFields(std::index_sequence<I...>, Values&&... values)
+	{
+		(std::get<I>(columns).insert(std::forward<Values>(values)), ...);
+	}
+
+	// calls fn with every column
+	template <typename functionType>
+	void forEachColumn(functionType fn)
+	{
+		std::apply([&fn](auto & ... column) { (fn(column), ...); }, columns);
+	}
+
+	// reorders column, so that its i-th element becomes the one from order[i] position
+	template <typename type>
+	static void permute(Array<type> & column, const Array<s64> & order)
+	{
+		Array<type> sorted;
+		sorted.reserve(order.size());
+		for (s64 i = 0; i < order.size(); ++i) sorted.insert(std::move(column.at_unchecked(order.at_unchecked(i))));
+		column = std::move(sorted);
+	}
+
+public:
+
+	template <size_t I>
+	using field = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+	// proxy to one record, fields are read and written through get<I>()
+	class Row
+	{
+		friend class SoAArray;
+
+		SoAArray* array;
+		s64 index;
+
+		Row(SoAArray* array, s64 index): array(array), index(index) { /* empty */ }
+
+	public:
+		template <size_t I>
+		field<I> & get() const { return array->template get<I>(index); }
+
+		s64 position() const { return index; }
+	};
+
+	class iterator : public std::iterator<std::input_iterator_tag, Row>
+	{
+		friend class SoAArray;
+
+		SoAArray* array;
+		s64 index;
+
+		iterator(SoAArray* array, s64 index): array(array), index(index) { /* empty */ }
+
+	public:
+		// default non usable constructor, which returns invalid iterator
+		iterator(): array(nullptr), index(0) { /* empty */ }
+
+		iterator & operator++()
+		{
+			++index;
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			iterator result(*this);
+			++(*this);
+			return result;
+		}
+
+		Row operator*() const { return Row(array, index); }
+
+		bool operator==(const iterator & it) const { return this->array == it.array && this->index == it.index; }
+		bool operator!=(const iterator & it) const { return !(*this == it); }
+	};
+
+	// constructor
+	SoAArray(): columns() { /* empty */ }
+
+	// copy constructor
+	SoAArray(const SoAArray & arr): columns(arr.columns) { /* empty */ }
+
+	// move constructor
+	SoAArray(SoAArray && arr): columns(std::move(arr.columns)) { /* empty */ }
+
+	// copy/move assignment utilizing copy/move constructor by taking argument as value
+	SoAArray & operator=(SoAArray arr)
+	{
+		::swap(columns, arr.columns);
+		return *this;
+	}
+
+	// appends record made of given fields
+	template <typename... Values>
+	void insert(Values&&... values)
+	{
+		static_assert(sizeof...(Values) == sizeof...(Fields), "SoAArray: insert needs a value for every field");
+		insertFields(field_indices(), std::forward<Values>(values)...);
+	}
+
+	// removes record at specified position
+	// ordered preserves order (default), not ordered moves last record to the place of removal, which is O(1)
+	void remove(s64 position, bool ordered = true)
+	{
+		if (position < 0 || position >= size())
+			ERROR("SoAArray (size %lld) can't remove record from %lld position - out of range", size(), position);
+		forEachColumn([position, ordered](auto & column) { column.remove(position, ordered); });
+	}
+
+	// elements of I-th field, elements can be changed, but not their amount
+	template <size_t I>
+	ArraySpan<field<I>> column() { return std::get<I>(columns).span(); }
+
+	template <size_t I>
+	ArrayView<field<I>> column() const { return std::get<I>(columns).view(); }
+
+	// I-th field of record at index, index is checked only in debug builds just like in Array
+	template <size_t I>
+	field<I> & get(s64 index) { return std::get<I>(columns)[index]; }
+
+	template <size_t I>
+	const field<I> & get(s64 index) const { return std::get<I>(columns)[index]; }
+
+	Row row(s64 index)
+	{
+#ifndef NDEBUG
+		if (index < 0 || index >= size())
+			ERROR("SoAArray (size %lld) can't get record from %lld position - out of range", size(), index);
+#endif
+		return Row(this, index);
+	}
+
+	Row operator[](s64 index) { return row(index); }
+
+	// stable sort of records by I-th field, order is sorted once and then applied to every column
+	template <size_t I, typename compareType = compare_less<field<I>>>
+	void sort_by_column(compareType compare = compare_less<field<I>>())
+	{
+		const s64 size = this->size();
+		if (size <= 1) return;
+
+		Array<s64> order;
+		order.reserve(size);
+		for (s64 i = 0; i < size; ++i) order.insert(i);
+
+		const field<I>* keys = std::get<I>(columns).data();
+		mergeSort(order.span(), [keys, &compare](s64 lhs, s64 rhs) { return compare(keys[lhs], keys[rhs]); });
+		forEachColumn([&order](auto & column) { permute(column, order); });
+	}
+
+	void reserve(s64 capacity) { forEachColumn([capacity](auto & column) { column.reserve(capacity); }); }
+	void shrink_to_fit() { forEachColumn([](auto & column) { column.shrink_to_fit(); }); }
+	void clear() { forEachColumn([](auto & column) { column.clear(); }); }
+
+	inline s64 size() const { return std::get<0>(columns).size(); }
+	inline bool isEmpty() const { return size() == 0; }
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, size()); }
+};
+
+
+#endif
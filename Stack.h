@@ -1,112 +1,92 @@
 #ifndef _stack_h
 #define _stack_h
 
-#include <cstdint> // int8_t ... types
-#include <cstdlib> // snprintf, malloc, free
-#include "error.h"
 #include <iostream>
+#include "Allocator.h"
+#include "utility.h"
 
 
-typedef std::int8_t  s8;
-typedef std::int16_t s16;
-typedef std::int32_t s32;
-typedef std::int64_t s64;
-
-typedef std::uint8_t  u8;
-typedef std::uint16_t u16;
-typedef std::uint32_t u32;
-typedef std::uint64_t u64;
-
-#define ERROR(MESSAGE, ...) error(__FILE__, __LINE__, MESSAGE, __VA_ARGS__)
-
-template <typename type>
+// cells are allocated through allocatorType policy (see Allocator.h), PoolAllocator reuses popped cells
+// and releases the whole stack at once
+template <typename type, typename allocatorType = heap_allocator>
 class Stack
 {
 	struct Cell
 	{
 		type data;
 		Cell *next;
+
+		Cell(type && data, Cell *next): data(std::move(data)), next(next) { /* empty */ }
 	};
 
 	s64 count; // how many elements in a linked list
 	Cell *first; // pointer to a first element
+	allocatorType allocator; // every cell of this stack comes from it
 
-	// recursively destructs all objects within linked list container
+	// destructs all objects within linked list container
+	// allocator releasing everything at once only needs objects destructed, memory isn't given back cell by cell
 	void destructInternalData(Cell *list)
 	{
-		if (list->next != nullptr) destructInternalData(list->next);
-		list->~Cell(); // manually destruct object, which will call data.~type() destructor
-		free(list); // then free memory
+		while (list != nullptr)
+		{
+			Cell *next = list->next;
+			list->~Cell(); // manually destruct object, which will call data.~type() destructor
+			if (!allocatorType::BULK_RELEASE) allocator.deallocate(list, sizeof(Cell)); // then free memory
+			list = next;
+		}
+		allocator.release();
 	}
 
 	// Creates new Cell with el as data and add's to the top of linked list
 	void pushElement(type el)
 	{
-		Cell *new_cell = (Cell*)malloc(sizeof(Cell));
-		new_cell->data = std::move(el);
-		new_cell->next = first;
-		first = new_cell;
+		first = new (allocator.allocate(sizeof(Cell))) Cell(std::move(el), first);
 		++count;
 	}
 
 	// recursively copy data from list to this
-	void copyInternalData(Cell *list) const
+	void copyInternalData(Cell *list)
 	{
 		if (list->next != nullptr) copyInternalData(list->next);
 		pushElement(list->data);
 	}
 
-	// same as copyInternalData, just moves data from list instead of copying
-	void moveInternalData(Cell *list)
-	{
-		if (list->next != nullptr) moveInternalData(list->next);
-		pushElement(std::move(list->data));
-	}
-
 public:
 
-	Stack()
-	{
-		first = nullptr;
-		count = 0;
-	}
+	Stack(): count(0), first(nullptr), allocator() { /* empty */ }
 
 	// uniform initialization -  Stack<float> stack = { 2.3, 2.4 ... }
-	Stack(const std::initializer_list<type> & il)
+	Stack(const std::initializer_list<type> & il): Stack()
 	{
-		first = nullptr;
-		count = 0;
 		for (auto & el : il) pushElement(el);
 	}
 
 	~Stack()
 	{
-		if (first != nullptr) destructInternalData(first);
+		destructInternalData(first);
 	}
 
-	// copy constructor
-	Stack(const Stack<type> & stack)
+	// copy constructor, copy gets its own allocator
+	Stack(const Stack & stack): Stack()
 	{
-		first = nullptr;
-		count = 0;
 		if (stack.first != nullptr) copyInternalData(stack.first);
 	}
 
-	// move constructor
-	Stack(Stack<type> && stack)
+	// move constructor, cells stay in the allocator they came from, so it moves along
+	Stack(Stack && stack): count(stack.count), first(stack.first), allocator(std::move(stack.allocator))
 	{
-		first = nullptr;
-		count = 0;
-		if (stack.first != nullptr) moveInternalData(stack.first);
+		stack.first = nullptr;
+		stack.count = 0;
 	}
 
 	// copy/move assignment utilizing copy/move constructor by taking argument as value
-	Stack & operator=(Stack<type> stack)
+	Stack & operator=(Stack stack)
 	{
-		destructInternalData(this->first);
-		count = 0;
-		if (stack.first != nullptr) moveInternalData(stack.first);
-
+		// qualified, so that std::swap isn't found through type's namespace as well
+		::swap(count, stack.count);
+		::swap(first, stack.first);
+		::swap(allocator, stack.allocator);
+		// stack going out of scope will destruct old data
 		return *this;
 	}
 
@@ -136,7 +116,7 @@ public:
 		// even though we moved data, if type object doesnt implement move constructor, then we are
 		// copying said data, leaving it untouched, therefore we have to explicitly destruct it
 		old_cell->~Cell();
-		free(old_cell);
+		allocator.deallocate(old_cell, sizeof(Cell));
 		--count;
 
 		return result;
@@ -158,4 +138,4 @@ public:
 	}
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,224 @@
+#ifndef _taskpool_h
+#define _taskpool_h
+
+#include <atomic> // atomic
+#include <thread> // thread, hardware_concurrency, yield
+#include <mutex> // mutex, unique_lock
+#include <condition_variable> // condition_variable
+#include <deque> // deque
+#include <functional> // function
+#include "Array.h"
+#include "utility.h"
+
+
+// small work stealing thread pool for fork-join parallelism
+// every worker has its own queue, it takes newest tasks from its back (the ones whose data is still in its cache),
+// idle workers steal the oldest tasks, usually the largest pieces of work, from the front of other queues
+// threads outside of the pool push tasks round robin and help executing them while waiting for a TaskGroup
+class TaskPool
+{
+	typedef std::function<void()> task;
+
+	// aligned to cache line, so that locks of neighbouring queues don't share one
+	struct alignas(64) task_queue
+	{
+		std::mutex lock;
+		std::deque<task> tasks;
+	};
+
+	Array<std::thread> workers;
+	task_queue* queues; // one per worker
+	s64 queue_count;
+
+	std::atomic<s64> queued; // tasks waiting in all queues
+	std::atomic<u64> next_queue; // round robin position for tasks pushed from outside of the pool
+	std::atomic<bool> stopping;
+	// idle workers sleep on it until some task is pushed
+	std::mutex idle_lock;
+	std::condition_variable idle;
+
+	// pool and queue of the worker running on this thread, pool is nullptr for threads outside of any pool
+	struct worker_identity
+	{
+		const TaskPool* pool;
+		s64 index;
+	};
+
+	static worker_identity & identity()
+	{
+		thread_local worker_identity worker = { nullptr, -1 };
+		return worker;
+	}
+
+	// index of worker's own queue, -1 for threads outside of this pool
+	s64 workerIndex() const { return identity().pool == this ? identity().index : -1; }
+
+	bool popFrom(s64 index, bool back, task & result)
+	{
+		task_queue & queue = queues[index];
+		std::unique_lock<std::mutex> guard(queue.lock);
+		if (queue.tasks.empty()) return false;
+		if (back)
+		{
+			result = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			result = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		queued.fetch_sub(1);
+		return true;
+	}
+
+	// takes a task from own queue or steals one from others
+	bool take(task & result)
+	{
+		if (queue_count == 0) return false;
+		s64 own = workerIndex();
+		if (own != -1 && popFrom(own, /*back*/ true, result)) return true;
+
+		s64 start = own != -1 ? own + 1 : (s64)(next_queue.load() % queue_count);
+		for (s64 i = 0; i < queue_count; ++i)
+			if (popFrom((start + i) % queue_count, /*back*/ false, result)) return true;
+		return false;
+	}
+
+	void workerLoop(s64 index)
+	{
+		identity() = { this, index };
+		task current;
+		while (true)
+		{
+			if (take(current))
+			{
+				current();
+				current = nullptr;
+				continue;
+			}
+			std::unique_lock<std::mutex> guard(idle_lock);
+			idle.wait(guard, [this] { return queued.load() > 0 || stopping.load(); });
+			if (stopping.load() && queued.load() == 0) return;
+		}
+	}
+
+public:
+
+	// threads - amount of worker threads, -1 means one less than amount of cores, as caller helps too
+	TaskPool(s64 threads = -1): workers(), queues(nullptr), queue_count(0), queued(0), next_queue(0), stopping(false)
+	{
+		if (threads < 0)
+		{
+			threads = (s64)std::thread::hardware_concurrency() - 1;
+			if (threads < 0) threads = 0;
+		}
+		queue_count = threads;
+		if (threads == 0) return;
+
+		queues = new task_queue[threads];
+		workers.reserve(threads);
+		for (s64 i = 0; i < threads; ++i) workers.emplace_back(&TaskPool::workerLoop, this, i);
+	}
+
+	TaskPool(const TaskPool &) = delete;
+	TaskPool & operator=(const TaskPool &) = delete;
+
+	// waits for all pushed tasks to finish
+	~TaskPool()
+	{
+		{
+			std::unique_lock<std::mutex> guard(idle_lock);
+			stopping.store(true);
+		}
+		idle.notify_all();
+		for (std::thread & worker : workers) worker.join();
+		delete[] queues;
+	}
+
+	// pool shared by parallel algorithms, created on first use
+	static TaskPool & global()
+	{
+		static TaskPool pool;
+		return pool;
+	}
+
+	// amount of worker threads, pool with none runs every task on the thread waiting for it
+	s64 threads() const { return queue_count; }
+
+	void push(task fn)
+	{
+		if (queue_count == 0)
+		{
+			fn();
+			return;
+		}
+		s64 index = workerIndex();
+		if (index == -1) index = (s64)(next_queue.fetch_add(1) % queue_count);
+		{
+			std::unique_lock<std::mutex> guard(queues[index].lock);
+			queues[index].tasks.push_back(std::move(fn));
+			queued.fetch_add(1);
+		}
+		// lock makes sure worker checking queued isn't between the check and going to sleep
+		{ std::unique_lock<std::mutex> guard(idle_lock); }
+		idle.notify_one();
+	}
+
+	// runs one waiting task on the calling thread, returns false if there was none
+	bool runOne()
+	{
+		task current;
+		if (!take(current)) return false;
+		current();
+		return true;
+	}
+};
+
+
+// tasks run through one group can be waited for together, waiting thread executes tasks meanwhile,
+// so groups can be nested (task can run its own group) without blocking workers
+class TaskGroup
+{
+	TaskPool & pool;
+	std::atomic<s64> pending;
+
+public:
+	TaskGroup(TaskPool & pool = TaskPool::global()): pool(pool), pending(0) { /* empty */ }
+
+	TaskGroup(const TaskGroup &) = delete;
+	TaskGroup & operator=(const TaskGroup &) = delete;
+
+	~TaskGroup() { wait(); }
+
+	template <typename functionType>
+	void run(functionType fn)
+	{
+		pending.fetch_add(1);
+		pool.push([this, fn]() mutable
+		{
+			fn();
+			pending.fetch_sub(1);
+		});
+	}
+
+	void wait()
+	{
+		while (pending.load() > 0)
+			if (!pool.runOne()) std::this_thread::yield();
+	}
+};
+
+
+// calls fn(i) for every i within [0, count), each call as a separate task
+template <typename functionType>
+void parallel_for(s64 count, functionType fn, TaskPool & pool = TaskPool::global())
+{
+	TaskGroup group(pool);
+	for (s64 i = 1; i < count; ++i) group.run([&fn, i] { fn(i); });
+	if (count > 0) fn(0);
+	group.wait();
+}
+
+
+#endif
@@ -0,0 +1,84 @@
+// compares hash_bytes (seeded, word at a time) with byte at a time DJB2 the maps used before,
+// both on their own and as HashMap<const char*> hash policies, for keys 4 to 256 bytes long
+// build as a single translation unit with optimizations, e.g. cl /std:c++17 /O2 bench_hash.cpp
+
+#include <cstdio>
+#include "Array.h"
+#include "HashMap.h"
+#include "utility.h"
+
+
+static const s64 KEYS = 1 << 16;
+static const s64 HASHES = 1 << 23;
+static const s64 LOOKUPS = 1 << 20;
+// maps are built this many times, one build of KEYS keys is too short for a millisecond timer
+static const s64 BUILDS = 8;
+
+// previous hashCode, seed is ignored
+static u64 djb2(const char* key, u64 length)
+{
+	u64 hash = 5381;
+	for (u64 i = 0; i < length; ++i) hash = hash * 33 + (u8)key[i];
+	return hash;
+}
+
+struct djb2_hash
+{
+	u64 operator()(const char* key, u64 length, u64) const { return djb2(key, length); }
+};
+
+template <typename hashType>
+static void mapTimes(const char* name, const Array<char> & text, s64 length)
+{
+	HashMap<const char*, s64, hashType> map;
+	getTimeElapsed();
+	for (s64 build = 0; build < BUILDS; ++build)
+	{
+		map = HashMap<const char*, s64, hashType>();
+		for (s64 i = 0; i < KEYS; ++i) map.insert(key_traits<const char*>::view(text.data() + i * length, length), i);
+	}
+	double insert_ms = getTimeElapsed();
+
+	s64 found = 0;
+	getTimeElapsed();
+	for (s64 i = 0; i < LOOKUPS; ++i)
+		found += map.contains(key_traits<const char*>::view(text.data() + (i & (KEYS - 1)) * length, length));
+	double lookup_ms = getTimeElapsed();
+
+	Array<s64> histogram = map.probe_histogram();
+	s64 sum = 0;
+	for (s64 d = 0; d < histogram.size(); ++d) sum += d * histogram[d];
+
+	printf("  %-10s insert %7.2f ns/op  lookup %7.2f ns/op  mean probe %5.3f  max probe %4lld  (found %lld)\n", name,
+		insert_ms * 1e6 / (KEYS * BUILDS), lookup_ms * 1e6 / LOOKUPS, (double)sum / map.size(), histogram.size() - 1, found);
+}
+
+int main()
+{
+	Random64 rng;
+	const s64 lengths[] = { 4, 8, 12, 16, 24, 32, 64, 128, 256 };
+	for (s64 length : lengths)
+	{
+		// KEYS keys of length letters one after another, few distinct letters make DJB2 collide more
+		Array<char> text;
+		text.reserve(KEYS * length);
+		for (s64 i = 0; i < KEYS * length; ++i) text.insert((char)('a' + rng.random() % 16));
+
+		const u64 seed = hash_seed();
+		u64 sink = 0;
+		getTimeElapsed();
+		for (s64 i = 0; i < HASHES; ++i) sink += hash_bytes(text.data() + (i & (KEYS - 1)) * length, length, seed);
+		double hash_ms = getTimeElapsed();
+
+		getTimeElapsed();
+		for (s64 i = 0; i < HASHES; ++i) sink += djb2(text.data() + (i & (KEYS - 1)) * length, length);
+		double djb2_ms = getTimeElapsed();
+
+		printf("%3lld bytes: hash_bytes %6.2f ns (%5.2f GB/s)  djb2 %6.2f ns (%5.2f GB/s)  [%llu]\n", length,
+			hash_ms * 1e6 / HASHES, length * HASHES / (hash_ms * 1e6), djb2_ms * 1e6 / HASHES, length * HASHES / (djb2_ms * 1e6),
+			sink & 1);
+		mapTimes<hash_of<const char*>>("hash_bytes", text, length);
+		mapTimes<djb2_hash>("djb2", text, length);
+	}
+	return 0;
+}
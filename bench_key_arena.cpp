@@ -0,0 +1,56 @@
+// arena size and insert / remove times of HashMap<const char*> with 40 byte keys, while keys are inserted
+// and removed at steady map size, so the map never grows or shrinks and only compaction reclaims removed keys
+// build as a single translation unit with optimizations, e.g. cl /std:c++17 /O2 bench_key_arena.cpp
+
+#include <cstdio>
+#include "Array.h"
+#include "HashMap.h"
+#include "utility.h"
+
+
+static const s64 KEY_LENGTH = 40;
+static const s64 LIVE_KEYS = 1 << 16;
+static const s64 CHURN = 1 << 20;
+static const s64 REPORTS = 8;
+
+// writes key number i, KEY_LENGTH letters long, into key
+static void makeKey(char* key, s64 i)
+{
+	for (s64 c = 0; c < KEY_LENGTH; ++c) key[c] = 'a' + (char)((i >> ((c % 8) * 4)) & 15);
+}
+
+int main()
+{
+	HashMap<const char*, s64> map;
+	char key[KEY_LENGTH];
+	for (s64 i = 0; i < LIVE_KEYS; ++i)
+	{
+		makeKey(key, i);
+		map.insert(key_traits<const char*>::view(key, KEY_LENGTH), i);
+	}
+	const u64 live_bytes = LIVE_KEYS * (KEY_LENGTH + 1);
+	printf("%lld live keys of %lld bytes, %llu bytes\n", LIVE_KEYS, KEY_LENGTH, live_bytes);
+
+	// every step removes the oldest key and inserts a fresh one, without compaction arena would grow by CHURN keys
+	u64 max_bytes = 0;
+	getTimeElapsed();
+	for (s64 i = 0; i < CHURN; ++i)
+	{
+		makeKey(key, i);
+		map.remove(key_traits<const char*>::view(key, KEY_LENGTH));
+		makeKey(key, i + LIVE_KEYS);
+		map.insert(key_traits<const char*>::view(key, KEY_LENGTH), i);
+
+		if (map.arena_bytes() > max_bytes) max_bytes = map.arena_bytes();
+		if ((i + 1) % (CHURN / REPORTS) == 0)
+		{
+			double churn_ms = getTimeElapsed();
+			printf("%8lld removed and inserted: arena %10llu bytes (%.2fx live)  %6.1f ns/op\n", i + 1, map.arena_bytes(),
+				(double)map.arena_bytes() / live_bytes, churn_ms * 1e6 / (2 * (CHURN / REPORTS)));
+			getTimeElapsed();
+		}
+	}
+	printf("max arena %llu bytes (%.2fx live), uncompacted arena would hold %llu bytes, map size %lld\n", max_bytes,
+		(double)max_bytes / live_bytes, (LIVE_KEYS + CHURN) * (KEY_LENGTH + 1), map.size());
+	return 0;
+}
@@ -0,0 +1,104 @@
+// compares probe lengths and lookup times of HashMap (linear probing, max load 7/8)
+// and RobinHoodMap (Robin Hood probing with backward shift deletion, max load 9/10)
+// build as a single translation unit with optimizations, e.g. cl /std:c++17 /O2 bench_probe_lengths.cpp
+
+#include <cstdio>
+#include "Array.h"
+#include "HashMap.h"
+#include "RobinHoodMap.h"
+#include "utility.h"
+
+
+static const s64 KEYS = 1 << 20;
+static const s64 LOOKUPS = 1 << 22;
+static const s64 PROBE_KEYS = 1 << 16;
+static const s64 LONGEST_PRINTED = 16;
+
+// prints mean, 99th percentile and max of probe lengths together with the first LONGEST_PRINTED histogram buckets
+static void printHistogram(const char* name, const Array<s64> & histogram)
+{
+	s64 total = 0, sum = 0;
+	for (s64 d = 0; d < histogram.size(); ++d)
+	{
+		total += histogram[d];
+		sum += d * histogram[d];
+	}
+
+	s64 p99 = 0, seen = 0;
+	for (s64 d = 0; d < histogram.size(); ++d)
+	{
+		seen += histogram[d];
+		if (seen * 100 >= total * 99)
+		{
+			p99 = d;
+			break;
+		}
+	}
+
+	printf("%-12s mean %6.3f  p99 %4lld  max %4lld  |", name, total ? (double)sum / total : 0.0, p99, histogram.size() - 1);
+	for (s64 d = 0; d < histogram.size() && d < LONGEST_PRINTED; ++d) printf(" %lld", histogram[d]);
+	printf("\n");
+}
+
+template <typename mapType>
+static void lookups(const char* name, const mapType & map, const Array<u64> & keys)
+{
+	s64 found = 0;
+	getTimeElapsed();
+	for (s64 i = 0; i < LOOKUPS; ++i) found += map.contains(keys[i & (PROBE_KEYS - 1)]);
+	double hit_ms = getTimeElapsed();
+
+	// keys with top bit set are never inserted
+	getTimeElapsed();
+	for (s64 i = 0; i < LOOKUPS; ++i) found += map.contains(keys[i & (PROBE_KEYS - 1)] | (1ull << 63));
+	double miss_ms = getTimeElapsed();
+
+	printf("%-12s hit %6.2f ns/op  miss %6.2f ns/op  (found %lld)\n", name,
+		hit_ms * 1e6 / LOOKUPS, miss_ms * 1e6 / LOOKUPS, found);
+}
+
+int main()
+{
+	Random64 rng;
+	Array<u64> keys;
+	keys.reserve(KEYS);
+	for (s64 i = 0; i < KEYS; ++i) keys.insert(rng.random() & ~(1ull << 63));
+
+	// loads just below each map's growth point and right after it doubled
+	const s64 sizes[] = { KEYS / 2, KEYS * 7 / 8 - 1, KEYS * 9 / 10 - 1, KEYS };
+	for (s64 size : sizes)
+	{
+		HashMap<u64, u64> linear;
+		RobinHoodMap<u64, u64> robin_hood;
+		for (s64 i = 0; i < size; ++i)
+		{
+			linear.insert(keys[i], i);
+			robin_hood.insert(keys[i], i);
+		}
+
+		printf("\n%lld keys\n", size);
+		printHistogram("linear", linear.probe_histogram());
+		printHistogram("robin hood", robin_hood.probe_histogram());
+
+		// random inserted keys, power of 2 of them, so that picking one is just a mask
+		Array<u64> probes;
+		probes.reserve(PROBE_KEYS);
+		for (s64 i = 0; i < PROBE_KEYS; ++i) probes.insert(keys[rng.random() % size]);
+		lookups("linear", linear, probes);
+		lookups("robin hood", robin_hood, probes);
+
+		// churn: removing and inserting keeps the load, linear probing collects deleted slots meanwhile
+		for (s64 i = 0; i < size; ++i)
+		{
+			u64 fresh = rng.random() & ~(1ull << 63);
+			linear.remove(keys[i]);
+			robin_hood.remove(keys[i]);
+			linear.insert(fresh, i);
+			robin_hood.insert(fresh, i);
+		}
+		printHistogram("linear *", linear.probe_histogram());
+		printHistogram("robin hood *", robin_hood.probe_histogram());
+	}
+	printf("\n* after removing and inserting as many keys as map holds\n");
+	return 0;
+}
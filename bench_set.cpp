@@ -0,0 +1,61 @@
+// tree height and insert / contains / remove times of Set (AVL) for sorted, reverse sorted and random insert orders
+// unbalanced tree would reach height n - 1 on the first two
+// build as a single translation unit with optimizations, e.g. cl /std:c++17 /O2 bench_set.cpp
+
+#include <cmath> // log2
+#include <cstdio>
+#include "Array.h"
+#include "Set.h"
+#include "sorting.h" // shuffle
+#include "utility.h"
+
+
+static const s64 VALUES = 1 << 20;
+
+static void run(const char* name, const Array<s64> & values, const Array<s64> & lookups)
+{
+	Set<s64> set;
+	getTimeElapsed();
+	for (s64 i = 0; i < values.size(); ++i) set.insert(values[i]);
+	double insert_ms = getTimeElapsed();
+
+	s64 found = 0;
+	getTimeElapsed();
+	for (s64 i = 0; i < lookups.size(); ++i) found += set.contains(lookups[i]);
+	double contains_ms = getTimeElapsed();
+
+	const int height = set.height();
+	const bool balanced = set.isBalanced();
+
+	getTimeElapsed();
+	for (s64 i = 0; i < values.size(); ++i) set.remove(values[i]);
+	double remove_ms = getTimeElapsed();
+
+	printf("%-8s height %3d (%s)  insert %6.1f ns/op  contains %6.1f ns/op  remove %6.1f ns/op  (found %lld)\n",
+		name, height, balanced ? "balanced" : "NOT balanced", insert_ms * 1e6 / values.size(),
+		contains_ms * 1e6 / lookups.size(), remove_ms * 1e6 / values.size(), found);
+}
+
+int main()
+{
+	Array<s64> sorted;
+	sorted.reserve(VALUES);
+	for (s64 i = 0; i < VALUES; ++i) sorted.insert(i);
+
+	Array<s64> reversed;
+	reversed.reserve(VALUES);
+	for (s64 i = VALUES - 1; i >= 0; --i) reversed.insert(i);
+
+	Array<s64> random = sorted;
+	shuffle(random);
+
+	// same random lookups for every order, so contains times differ only by tree shape
+	Array<s64> lookups = sorted;
+	shuffle(lookups);
+
+	printf("%lld values, AVL height bound 1.44 * log2(n + 2) = %.1f\n", VALUES, 1.44 * std::log2((double)VALUES + 2));
+	run("sorted", sorted, lookups);
+	run("reverse", reversed, lookups);
+	run("random", random, lookups);
+	return 0;
+}
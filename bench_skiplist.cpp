@@ -0,0 +1,107 @@
+// compares ConcurrentSkipListSet with Set (AVL) behind one mutex, 1 to 64 threads running a mixed workload:
+// 20% inserts, 20% removes, 58% contains and 2% scans of the first SCAN_LENGTH values, all on random keys
+// total amount of operations is the same for every thread count, so ns/op falling with more threads means scaling
+// build as a single translation unit with optimizations, e.g. cl /std:c++17 /O2 bench_skiplist.cpp
+
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include "Array.h"
+#include "ConcurrentSkipListSet.h"
+#include "Set.h"
+#include "utility.h"
+
+
+static const s64 KEYS = 1 << 16;
+static const s64 OPERATIONS = 1 << 22;
+static const s64 SCAN_LENGTH = 32;
+
+// Set guarded by a single mutex, the simple way to share it between threads
+struct LockedSet
+{
+	Set<s64> set;
+	std::mutex lock;
+
+	bool insert(s64 value) { std::lock_guard<std::mutex> guard(lock); return set.insert(value); }
+	bool remove(s64 value) { std::lock_guard<std::mutex> guard(lock); return set.remove(value); }
+	bool contains(s64 value) { std::lock_guard<std::mutex> guard(lock); return set.contains(value); }
+
+	s64 scan()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		s64 sum = 0, seen = 0;
+		for (auto it = set.begin(); it != set.end() && seen < SCAN_LENGTH; ++it, ++seen) sum += *it;
+		return sum;
+	}
+};
+
+struct SkipListSet
+{
+	ConcurrentSkipListSet<s64> set;
+
+	bool insert(s64 value) { return set.insert(value); }
+	bool remove(s64 value) { return set.remove(value); }
+	bool contains(s64 value) { return set.contains(value); }
+
+	s64 scan()
+	{
+		s64 sum = 0, seen = 0;
+		for (auto it = set.begin(); it != set.end() && seen < SCAN_LENGTH; ++it, ++seen) sum += *it;
+		return sum;
+	}
+};
+
+template <typename setType>
+static void work(setType* set, s64 operations, u64 seed, s64* sink)
+{
+	Random64 rng(seed, seed * 3 + 1, seed * 5 + 2, seed * 7 + 3);
+	s64 result = 0;
+	for (s64 i = 0; i < operations; ++i)
+	{
+		const s64 key = (s64)(rng.random() % KEYS);
+		const u64 kind = rng.random() % 100;
+		if (kind < 20) result += set->insert(key);
+		else if (kind < 40) result += set->remove(key);
+		else if (kind < 98) result += set->contains(key);
+		else result += set->scan();
+	}
+	*sink = result;
+}
+
+// returns wall clock ns per operation of all threads together, results of operations are summed into checksum
+template <typename setType>
+static double run(s64 threads, s64 & checksum)
+{
+	setType set;
+	// half of the keys present, inserts and removes keep it around half
+	for (s64 key = 0; key < KEYS; key += 2) set.insert(key);
+
+	Array<std::thread> workers;
+	Array<s64> sinks;
+	for (s64 t = 0; t < threads; ++t) sinks.insert(0);
+
+	getTimeElapsed();
+	for (s64 t = 0; t < threads; ++t)
+		workers.insert(std::thread(work<setType>, &set, OPERATIONS / threads, (u64)t + 1, &sinks[t]));
+	for (std::thread & worker : workers) worker.join();
+	double elapsed_ms = getTimeElapsed();
+
+	for (s64 t = 0; t < threads; ++t) checksum += sinks[t];
+	return elapsed_ms * 1e6 / (OPERATIONS / threads * threads);
+}
+
+int main()
+{
+	printf("%lld keys, %lld operations per thread count, hardware threads %u\n", KEYS, OPERATIONS,
+		std::thread::hardware_concurrency());
+	const s64 thread_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+	for (s64 threads : thread_counts)
+	{
+		s64 checksum = 0;
+		double skip_list = run<SkipListSet>(threads, checksum);
+		double locked = run<LockedSet>(threads, checksum);
+		printf("%2lld threads: skip list %7.1f ns/op  locked Set %7.1f ns/op  (%.2fx)  [%lld]\n",
+			threads, skip_list, locked, locked / skip_list, checksum & 1);
+	}
+	return 0;
+}
@@ -0,0 +1,243 @@
+#ifndef _parallel_sorting_h
+#define _parallel_sorting_h
+
+#include <cstdlib> // malloc, free
+#include "Array.h"
+#include "ArrayView.h"
+#include "TaskPool.h"
+#include "sorting.h" // sequential kernels
+#include "utility.h"
+
+
+// multithreaded versions of sorting.h sorts, they take the same comparators and run on TaskPool (global by default)
+// arrays too small to be worth splitting are sorted by the sequential kernels on the calling thread
+
+// ranges of at most this many elements are sorted sequentially
+static const s64 PARALLEL_SORT_CUTOFF = 1 << 14;
+// merges of at most this many elements are done sequentially
+static const s64 PARALLEL_MERGE_CUTOFF = 1 << 13;
+
+
+// SAMPLE SORT
+// splitters chosen from a random sample divide values into buckets (about 4 per thread), blocks of the array
+// count and then move their values to buckets' places in auxiliary memory, then buckets are sorted at once
+// every step is parallel, so there is no sequential partition pass at the top as in recursive parallel quicksort
+
+// returns bucket of value - amount of splitters smaller than value
+template <typename type, typename compareType>
+s64 sampleBucket(const type & value, const type* splitters, s64 splitter_count, compareType & compare)
+{
+	s64 start = 0, end = splitter_count;
+	while (start < end)
+	{
+		s64 middle = start + (end - start) / 2;
+		if (compare(splitters[middle], value)) start = middle + 1;
+		else end = middle;
+	}
+	return start;
+}
+
+template <typename type, typename compareType = compare_less<type>>
+void parallelQuickSort(type* data, s64 size, compareType compare = compare_less<type>(), TaskPool & pool = TaskPool::global())
+{
+	if (size <= PARALLEL_SORT_CUTOFF || pool.threads() == 0)
+	{
+		Random64 rng;
+		quickSort(data, size, rng, compare);
+		return;
+	}
+
+	const s64 threads = pool.threads() + 1;
+	const s64 OVERSAMPLE = 16;
+	s64 buckets = threads * 4;
+	if (buckets > size / PARALLEL_SORT_CUTOFF * 4) buckets = size / PARALLEL_SORT_CUTOFF * 4;
+	if (buckets < 2) buckets = 2;
+
+	// splitters are evenly spaced values of sorted random sample
+	Array<type> sample;
+	sample.reserve(buckets * OVERSAMPLE);
+	Random64 rng;
+	for (s64 i = 0; i < buckets * OVERSAMPLE; ++i) sample.insert(data[rng.random() % size]);
+	quickSort(sample.data(), sample.size(), rng, compare);
+	Array<type> splitters;
+	splitters.reserve(buckets - 1);
+	for (s64 b = 1; b < buckets; ++b) splitters.insert(sample.at_unchecked(b * OVERSAMPLE));
+	const type* split = splitters.data();
+	const s64 split_count = splitters.size();
+
+	// block t counts its values falling into bucket b at counts[t * buckets + b]
+	const s64 blocks = threads * 4;
+	const s64 block_size = (size + blocks - 1) / blocks;
+	Array<s64> counts(blocks * buckets, 0);
+	s64* count = counts.data();
+	parallel_for(blocks, [&](s64 t)
+	{
+		const s64 end = (t + 1) * block_size < size ? (t + 1) * block_size : size;
+		for (s64 i = t * block_size; i < end; ++i) count[t * buckets + sampleBucket(data[i], split, split_count, compare)] += 1;
+	}, pool);
+
+	// counts become positions where block's values of bucket start, buckets lie one after another
+	Array<s64> bucket_start(buckets + 1, 0);
+	s64 position = 0;
+	for (s64 b = 0; b < buckets; ++b)
+	{
+		bucket_start[b] = position;
+		for (s64 t = 0; t < blocks; ++t)
+		{
+			s64 amount = count[t * buckets + b];
+			count[t * buckets + b] = position;
+			position += amount;
+		}
+	}
+	bucket_start[buckets] = size;
+
+	type* aux = (type*)malloc(size * sizeof(type));
+	if (aux == nullptr) ERROR("parallelQuickSort: failed to allocate %lld elements of auxiliary memory", size);
+	parallel_for(blocks, [&](s64 t)
+	{
+		const s64 end = (t + 1) * block_size < size ? (t + 1) * block_size : size;
+		for (s64 i = t * block_size; i < end; ++i)
+		{
+			s64 & pos = count[t * buckets + sampleBucket(data[i], split, split_count, compare)];
+			new(aux + pos++) type(std::move(data[i]));
+		}
+	}, pool);
+
+	// bucket of many equal values ends up as one large sequential sort, which quickSort handles in O(n log n)
+	const s64* starts = bucket_start.data();
+	parallel_for(buckets, [&](s64 b)
+	{
+		thread_local Random64 bucket_rng;
+		quickSort(aux + starts[b], starts[b + 1] - starts[b], bucket_rng, compare);
+		for (s64 i = starts[b]; i < starts[b + 1]; ++i)
+		{
+			data[i] = std::move(aux[i]);
+			aux[i].~type();
+		}
+	}, pool);
+	free(aux);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+void parallelQuickSort(ArraySpan<type> span, compareType compare = compare_less<type>(), TaskPool & pool = TaskPool::global())
+{
+	parallelQuickSort(span.data(), span.size(), compare, pool);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+void parallelQuickSort(Array<type> & arr, compareType compare = compare_less<type>(), TaskPool & pool = TaskPool::global())
+{
+	parallelQuickSort(arr.data(), arr.size(), compare, pool);
+}
+
+
+// MERGE SORT
+// halves are sorted in parallel and merged by parallel merge, which splits at the middle of the longer run and
+// binary searches the matching position in the other one, so both parts can be merged at once, stable
+
+// moves runs lhs and rhs merged into out
+template <typename type, typename compareType>
+void parallelMerge(type* lhs, s64 lhs_size, type* rhs, s64 rhs_size, type* out, compareType & compare, TaskPool & pool)
+{
+	if (lhs_size + rhs_size <= PARALLEL_MERGE_CUTOFF)
+	{
+		s64 l = 0, r = 0;
+		while (l < lhs_size && r < rhs_size)
+		{
+			if (compare(rhs[r], lhs[l])) *out++ = std::move(rhs[r++]);
+			else *out++ = std::move(lhs[l++]);
+		}
+		while (l < lhs_size) *out++ = std::move(lhs[l++]);
+		while (r < rhs_size) *out++ = std::move(rhs[r++]);
+		return;
+	}
+
+	s64 l, r;
+	if (lhs_size >= rhs_size)
+	{
+		// rhs values equal to lhs[l] have to stay behind it
+		l = lhs_size / 2;
+		s64 start = 0, end = rhs_size;
+		while (start < end)
+		{
+			s64 middle = start + (end - start) / 2;
+			if (compare(rhs[middle], lhs[l])) start = middle + 1;
+			else end = middle;
+		}
+		r = start;
+		out[l + r] = std::move(lhs[l]);
+		TaskGroup group(pool);
+		group.run([=, &compare, &pool] { parallelMerge(lhs, l, rhs, r, out, compare, pool); });
+		parallelMerge(lhs + l + 1, lhs_size - l - 1, rhs + r, rhs_size - r, out + l + r + 1, compare, pool);
+		group.wait();
+	}
+	else
+	{
+		// lhs values equal to rhs[r] have to stay in front of it
+		r = rhs_size / 2;
+		s64 start = 0, end = lhs_size;
+		while (start < end)
+		{
+			s64 middle = start + (end - start) / 2;
+			if (!compare(rhs[r], lhs[middle])) start = middle + 1;
+			else end = middle;
+		}
+		l = start;
+		out[l + r] = std::move(rhs[r]);
+		TaskGroup group(pool);
+		group.run([=, &compare, &pool] { parallelMerge(lhs, l, rhs, r, out, compare, pool); });
+		parallelMerge(lhs + l, lhs_size - l, rhs + r + 1, rhs_size - r - 1, out + l + r + 1, compare, pool);
+		group.wait();
+	}
+}
+
+// end included, aux has to hold at least end + 1 elements
+template <typename type, typename compareType>
+void parallelMergeSort(type* data, type* aux, s64 start, s64 end, compareType & compare, TaskPool & pool)
+{
+	if (end - start + 1 <= PARALLEL_SORT_CUTOFF)
+	{
+		// sequential kernel uses aux from its beginning, every range gets its own part
+		mergeSort(data, aux + start, start, end, compare);
+		return;
+	}
+
+	s64 mid = start + (end - start) / 2;
+	{
+		TaskGroup group(pool);
+		group.run([=, &compare, &pool] { parallelMergeSort(data, aux, start, mid, compare, pool); });
+		parallelMergeSort(data, aux, mid + 1, end, compare, pool);
+		group.wait();
+	}
+
+	// both sides already in order together
+	if (!compare(data[mid+1], data[mid])) return;
+
+	parallelMerge(data + start, mid - start + 1, data + mid + 1, end - mid, aux + start, compare, pool);
+	// merged values are moved back in parallel chunks
+	const s64 len = end - start + 1;
+	const s64 chunks = (len + PARALLEL_SORT_CUTOFF - 1) / PARALLEL_SORT_CUTOFF;
+	parallel_for(chunks, [=](s64 c)
+	{
+		const s64 chunk_end = start + (c + 1) * PARALLEL_SORT_CUTOFF <= end + 1 ? start + (c + 1) * PARALLEL_SORT_CUTOFF : end + 1;
+		for (s64 i = start + c * PARALLEL_SORT_CUTOFF; i < chunk_end; ++i) data[i] = std::move(aux[i]);
+	}, pool);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+void parallelMergeSort(ArraySpan<type> span, compareType compare = compare_less<type>(), TaskPool & pool = TaskPool::global())
+{
+	if (span.size() <= 1) return;
+	type* aux = new type[span.size()];
+	parallelMergeSort(span.data(), aux, 0, span.size() - 1, compare, pool);
+	delete[] aux;
+}
+
+template <typename type, typename compareType = compare_less<type>>
+void parallelMergeSort(Array<type> & arr, compareType compare = compare_less<type>(), TaskPool & pool = TaskPool::global())
+{
+	parallelMergeSort(arr.span(), compare, pool);
+}
+
+
+#endif
@@ -1,251 +1,480 @@
 #ifndef _sorting_h
 #define _sorting_h
 
+#include <cstring> // memcpy
+#include <type_traits> // decay
 #include "Array.h"
+#include "ArrayView.h"
 #include "utility.h" // swap function
 
 
+// sorting kernels work on raw memory (data, [start, end] with end included), so their inner loops index plain
+// pointers without bounds checks and can be vectorized, Array and ArraySpan versions below just pass their data
+
+
 // essentially just mergeSort with added counting how many inversions are done
 template <typename type, typename compareType = compare_less<type>> // end included
-s64 countingInversionsWrapper(Array<type> & arr, Array<type> & aux, s64 start, s64 end, compareType compare = compare_less<type>())
+s64 countingInversionsWrapper(type* data, type* aux, s64 start, s64 end, compareType compare = compare_less<type>())
 {
 	if (start >= end) return 0;
 	
 	s64 mid = start + (end - start) / 2;
-	s64 left  = countingInversionsWrapper(arr, aux, start, mid, compare);
-	s64 right = countingInversionsWrapper(arr, aux, mid + 1, end, compare);
+	s64 left  = countingInversionsWrapper(data, aux, start, mid, compare);
+	s64 right = countingInversionsWrapper(data, aux, mid + 1, end, compare);
 
 
 	s64 middle = 0;
-	if (compare(arr[mid+1], arr[mid]))
+	if (compare(data[mid+1], data[mid]))
 	{
 		s64 lhs = start;
 		s64 rhs = mid + 1;
 		s64 len = end - start + 1;
 		for (s64 i = 0; i < len; ++i)
 		{
-			if (lhs == mid + 1)						aux[i] = std::move(arr[rhs++]);
-			else if (rhs > end) 					aux[i] = std::move(arr[lhs++]);
-			else if (!compare(arr[rhs], arr[lhs]))	aux[i] = std::move(arr[lhs++]);
+			if (lhs == mid + 1)						aux[i] = std::move(data[rhs++]);
+			else if (rhs > end) 					aux[i] = std::move(data[lhs++]);
+			else if (!compare(data[rhs], data[lhs]))	aux[i] = std::move(data[lhs++]);
 			else 
 			{
-				aux[i] = std::move(arr[rhs++]);
+				aux[i] = std::move(data[rhs++]);
 				middle += mid - lhs + 1;
 			}
 		}
 		// transfer merged sides from auxiliary array back to actual array
-		for (s64 i = 0; i < len; ++i) arr[start + i] = std::move(aux[i]);		
+		for (s64 i = 0; i < len; ++i) data[start + i] = std::move(aux[i]);		
 	}
 	return left + middle + right;
 }
 
+template <typename type, typename compareType = compare_less<type>> // end included
+s64 countingInversionsWrapper(Array<type> & arr, Array<type> & aux, s64 start, s64 end, compareType compare = compare_less<type>())
+{
+	return countingInversionsWrapper(arr.data(), aux.data(), start, end, compare);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+s64 countingInversions(ArraySpan<type> span, compareType compare = compare_less<type>())
+{
+	if (span.size() <= 1) return 0;
+	Array<type> aux(span.size());
+	return countingInversionsWrapper(span.data(), aux.data(), 0, span.size() - 1, compare);
+}
 
 template <typename type, typename compareType = compare_less<type>>
 s64 countingInversions(Array<type> & arr, compareType compare = compare_less<type>())
 {
-	Array<type> aux(arr.size());
-	return countingInversionsWrapper(arr, aux, 0, arr.size() - 1, compare);
+	return countingInversions(arr.span(), compare);
 }
 
 
 // type has to consist of non-negative integers
 // radix is upper bound of those non-negative integers - [0, radix]
 template <typename type>
-void countingSort(Array<type> & arr, s64 radix)
+void countingSort(ArraySpan<type> span, s64 radix)
 {
 	if (radix <= 0) return;
 
-	s64 size = arr.size();
+	s64 size = span.size();
 	if (size == 0) return;
 
-	Array<s64> count(radix + 2, 0);
-	Array<type> aux(size, 0);
+	type* data = span.data();
+	Array<s64> counts(radix + 2, 0);
+	Array<type> auxiliary(size, 0);
+	s64* count = counts.data();
+	type* aux = auxiliary.data();
 
 	// count the frequencies of numbers in arr
-	for (s64 i = 0; i < size; ++i) count[arr[i] + 1] += 1;
+	for (s64 i = 0; i < size; ++i) count[data[i] + 1] += 1;
 	// transform frequencies to indices, starting position for each number in sorted array
 	for (s64 r = 1; r <= radix; ++r) count[r] += count[r-1];
 	// put values in sorted order in auxillary array
-	for (s64 i = 0; i < size; ++i) aux[count[arr[i]]++] = arr[i];
+	for (s64 i = 0; i < size; ++i) aux[count[data[i]]++] = data[i];
 	// copy back to real array
-	for (s64 i = 0; i < size; ++i) arr[i] = aux[i];
+	for (s64 i = 0; i < size; ++i) data[i] = aux[i];
 }
 
-// NOTE: doesnt WORK because you cant assign a value properly to Array<char*> 
-// all elements within arr have to be of the same length
-template <typename compareType = compare_less<type>>
-void LSDSort(Array<char*> & arr, compareType compare = compare_less<char*>())
+template <typename type>
+void countingSort(Array<type> & arr, s64 radix) { countingSort(arr.span(), radix); }
+
+template <typename type, typename compareType = compare_less<type>> // end included
+void insertionSort(type* data, s64 start, s64 end, compareType compare = compare_less<type>())
 {
-	s64 size = arr.size();
-	if (size == 0) return;
+	for (s64 i = start + 1; i <= end; ++i)
+	{
+		type el = std::move(data[i]);
+		s64 j = i - 1;
+		while (j >= start && compare(el, data[j]))
+		{
+			data[j + 1] = std::move(data[j]);
+			--j;
+		}
+		data[j + 1] = std::move(el);
+	}
+}
 
-	const u16 radix = 256;
-	s64 count[radix + 1] = {0};
-	char* aux = new char[size * length];
+template <typename type, typename compareType = compare_less<type>>
+void insertionSort(ArraySpan<type> span, compareType compare = compare_less<type>())
+{
+	insertionSort(span.data(), 0, span.size() - 1, compare);
+}
 
-	for (s64 c = length - 1; c >= 0; --c)
+template <typename type, typename compareType = compare_less<type>>
+void insertionSort(Array<type> & arr, compareType compare = compare_less<type>())
+{
+	insertionSort(arr.span(), compare);
+}
+
+
+// RADIX SORT
+// values are distributed by their keys one digit (8 or 11 bits) at a time like in countingSort, no comparisons are made
+
+// maps key to unsigned integer (bits) of the same size ordered the same way as keys
+// signed integers get their sign bit flipped, so negative ones come first
+// floats get sign bit flipped if positive and all bits flipped if negative, as bigger negative bits mean smaller value
+template <typename type> struct radix_key;
+
+template <> struct radix_key<u8>  { typedef u8  bits; static bits get(u8 key)  { return key; } };
+template <> struct radix_key<u16> { typedef u16 bits; static bits get(u16 key) { return key; } };
+template <> struct radix_key<u32> { typedef u32 bits; static bits get(u32 key) { return key; } };
+template <> struct radix_key<u64> { typedef u64 bits; static bits get(u64 key) { return key; } };
+
+template <> struct radix_key<s8>  { typedef u8  bits; static bits get(s8 key)  { return (u8)key ^ 0x80u; } };
+template <> struct radix_key<s16> { typedef u16 bits; static bits get(s16 key) { return (u16)key ^ 0x8000u; } };
+template <> struct radix_key<s32> { typedef u32 bits; static bits get(s32 key) { return (u32)key ^ 0x80000000u; } };
+template <> struct radix_key<s64> { typedef u64 bits; static bits get(s64 key) { return (u64)key ^ 0x8000000000000000ull; } };
+
+template <> struct radix_key<float>
+{
+	typedef u32 bits;
+	static bits get(float key)
 	{
-		// count the frequencies of chars within c position of each element in arr
-		for (s64 i = 0; i < size; ++i) count[arr[i][c] + 1] += 1;
-		// transform frequencies to indices, starting position for each number in sorted array
-		for (s64 r = 1; r <= radix; ++r) count[r] += count[r-1];
-		// put values in sorted order in auxillary array
-		for (s64 i = 0; i < size; ++i)
+		bits value;
+		memcpy(&value, &key, sizeof(value));
+		return (value & 0x80000000u) ? ~value : value | 0x80000000u;
+	}
+};
+
+template <> struct radix_key<double>
+{
+	typedef u64 bits;
+	static bits get(double key)
+	{
+		bits value;
+		memcpy(&value, &key, sizeof(value));
+		return (value & 0x8000000000000000ull) ? ~value : value | 0x8000000000000000ull;
+	}
+};
+
+// smaller arrays are sorted by insertionSort, clearing the histograms would take longer than sorting them
+static const s64 RADIX_INSERTION_CUTOFF = 64;
+
+// stable sort of size values by key(value), key has to return a type with radix_key (integer, float or double)
+// histograms of all digits are counted in one pass, digits which are the same for all values are skipped
+// values move between data and aux (at least size elements), sorted ones end up in data
+template <typename type, typename keyType>
+void radixSort(type* data, type* aux, s64 size, keyType key)
+{
+	typedef typename std::decay<decltype(key(*data))>::type key_value;
+	typedef typename radix_key<key_value>::bits bits;
+	// 11 bit digits need a pass less than bytes for 32 bit keys and two less for 64 bit ones,
+	// while their 2048 counts still fit in L1 cache
+	const s64 DIGIT_BITS = sizeof(bits) >= 4 ? 11 : 8;
+	const s64 DIGITS = (sizeof(bits) * 8 + DIGIT_BITS - 1) / DIGIT_BITS;
+	const s64 RADIX = (s64)1 << DIGIT_BITS;
+	const bits MASK = (bits)(RADIX - 1);
+	if (size <= RADIX_INSERTION_CUTOFF)
+	{
+		insertionSort(data, 0, size - 1, [&key](const type & lhs, const type & rhs)
+			{ return radix_key<key_value>::get(key(lhs)) < radix_key<key_value>::get(key(rhs)); });
+		return;
+	}
+
+	Array<s64> histograms(DIGITS * RADIX, 0);
+	s64* counts = histograms.data();
+	for (s64 i = 0; i < size; ++i)
+	{
+		bits value = radix_key<key_value>::get(key(data[i]));
+		for (s64 d = 0; d < DIGITS; ++d) counts[d * RADIX + ((value >> (DIGIT_BITS * d)) & MASK)] += 1;
+	}
+
+	type* from = data;
+	type* to = aux;
+	for (s64 d = 0; d < DIGITS; ++d)
+	{
+		s64* count = counts + d * RADIX;
+		if (count[(radix_key<key_value>::get(key(from[0])) >> (DIGIT_BITS * d)) & MASK] == size) continue;
+
+		// transform frequencies to starting position of each digit
+		s64 position = 0;
+		for (s64 r = 0; r < RADIX; ++r)
 		{
-			char* location = (aux + length * count[arr[i][c]]++);
-			for (s64 j = 0; j < length; ++j)
-			{
-				location[j] = arr[i][j];
-			}
+			s64 amount = count[r];
+			count[r] = position;
+			position += amount;
 		}
-		// copy back to real array
 		for (s64 i = 0; i < size; ++i)
 		{
-			for (s64 j = 0; j < length; ++j)
-			{
-				arr[i][j] = *(aux + length * i + j);
-			}
+			// digit has to be read before the value is moved away
+			s64 digit = (radix_key<key_value>::get(key(from[i])) >> (DIGIT_BITS * d)) & MASK;
+			to[count[digit]++] = std::move(from[i]);
 		}
-		// clear count for next iteration
-		for (s64 r = 0; r <= radix; ++r) count[r] = 0;
+		swap(from, to);
 	}
-	delete[] aux;
+	if (from != data) for (s64 i = 0; i < size; ++i) data[i] = std::move(from[i]);
+}
+
+// aux keeps its memory for next calls, so sorting many arrays with the same aux allocates only once
+template <typename type, typename keyType>
+void radixSort(ArraySpan<type> span, Array<type> & aux, keyType key)
+{
+	if (span.size() <= 1) return;
+	if (aux.size() < span.size())
+	{
+		aux.reserve(span.size());
+		while (aux.size() < span.size()) aux.emplace_back();
+	}
+	radixSort(span.data(), aux.data(), span.size(), key);
+}
+
+template <typename type, typename keyType>
+void radixSort(ArraySpan<type> span, keyType key)
+{
+	Array<type> aux;
+	radixSort(span, aux, key);
 }
 
+template <typename type, typename keyType>
+void radixSort(Array<type> & arr, keyType key) { radixSort(arr.span(), key); }
 
-// NOTE: doesnt WORK because you cant assign a value properly to Array<char*> 
-// all elements within arr have to be of the same length
-void LSDSortSLOW(Array<char*> & arr, s64 length)
+// values themselves are the keys - integers, floats or doubles
+template <typename type>
+void radixSort(ArraySpan<type> span, Array<type> & aux)
 {
-	s64 size = arr.size();
-	if (size == 0) return;
+	radixSort(span, aux, [](const type & value) { return value; });
+}
+
+template <typename type>
+void radixSort(ArraySpan<type> span)
+{
+	Array<type> aux;
+	radixSort(span, aux);
+}
+
+template <typename type>
+void radixSort(Array<type> & arr, Array<type> & aux) { radixSort(arr.span(), aux); }
+
+template <typename type>
+void radixSort(Array<type> & arr) { radixSort(arr.span()); }
 
-	const u16 radix = 256;
-	s64 count[radix + 1] = {0};
-	char** aux = new char*[size];
 
+// LSD sort of strings by their first length characters, all strings have to have at least length characters
+// only pointers are moved, strings stay where they are
+inline void LSDSort(ArraySpan<char*> span, s64 length, Array<char*> & aux)
+{
+	s64 size = span.size();
+	if (size <= 1) return;
+	if (aux.size() < size)
+	{
+		aux.reserve(size);
+		while (aux.size() < size) aux.insert(nullptr);
+	}
+
+	const s64 RADIX = 256;
+	char** from = span.data();
+	char** to = aux.data();
 	for (s64 c = length - 1; c >= 0; --c)
 	{
-		// count the frequencies of chars within c position of each element in arr
-		for (s64 i = 0; i < size; ++i) count[arr[i][c] + 1] += 1;
-		// transform frequencies to indices, starting position for each number in sorted array
-		for (s64 r = 1; r <= radix; ++r) count[r] += count[r-1];
-		// put values in sorted order in auxillary array
-		for (s64 i = 0; i < size; ++i) aux[count[arr[i][c]]++] = arr[i];
-		// copy back to real array
-		for (s64 i = 0; i < size; ++i) arr[i] = aux[i];
-
-		// clear count for next iteration
-		for (s64 r = 0; r <= radix; ++r) count[r] = 0;
+		s64 count[RADIX + 1] = {0};
+		// count the frequencies of chars within c position of each string
+		for (s64 i = 0; i < size; ++i) count[(u8)from[i][c] + 1] += 1;
+		// transform frequencies to indices, starting position for each char
+		for (s64 r = 1; r <= RADIX; ++r) count[r] += count[r-1];
+		// put strings in sorted order by c position into the other array
+		for (s64 i = 0; i < size; ++i) to[count[(u8)from[i][c]]++] = from[i];
+		swap(from, to);
 	}
-	delete[] aux;
+	if (from != span.data()) for (s64 i = 0; i < size; ++i) span.data()[i] = from[i];
 }
 
-template <typename type, typename compareType = compare_less<type>>
-void insertionSort(Array<type> & arr, compareType compare = compare_less<type>())
+inline void LSDSort(ArraySpan<char*> span, s64 length)
 {
-	s64 size = arr.size();
-	if (size <= 1) return;
+	Array<char*> aux;
+	LSDSort(span, length, aux);
+}
+
+inline void LSDSort(Array<char*> & arr, s64 length) { LSDSort(arr.span(), length); }
+
 
-	for (s64 i = 1; i < size; ++i)
+// character of string at position d as 0 - 255, -1 once string ends, so prefix comes before strings it is part of
+// MSDSort works with every type which has stringChar overload
+inline s32 stringChar(const char* str, s64 d) { return str[d] != '\0' ? (u8)str[d] : -1; }
+inline s32 stringChar(const Array<char> & str, s64 d) { return d < str.size() ? (u8)str.at_unchecked(d) : -1; }
+
+// buckets of at most this many strings are sorted by insertionSort
+static const s64 MSD_INSERTION_CUTOFF = 16;
+
+// MSD sort of strings of any length, they are distributed by d-th character and every bucket is sorted by next ones
+// aux has to hold at least end - start + 1 strings, it is used from its beginning
+template <typename type> // end included
+void MSDSort(type* data, type* aux, s64 start, s64 end, s64 d)
+{
+	const s64 RADIX = 256;
+	while (true)
 	{
-		type el = std::move(arr[i]);
-		s64 j = i - 1;
-		while (j >= 0 && compare(el, arr[j]))
+		if (end - start + 1 <= MSD_INSERTION_CUTOFF)
 		{
-			arr[j + 1] = std::move(arr[j]);
-			--j;
+			insertionSort(data, start, end, [d](const type & lhs, const type & rhs)
+			{
+				for (s64 c = d; ; ++c)
+				{
+					s32 l = stringChar(lhs, c);
+					s32 r = stringChar(rhs, c);
+					if (l != r) return l < r;
+					if (l == -1) return false;
+				}
+			});
+			return;
 		}
-		arr[j + 1] = std::move(el);
+
+		// count[c + 2] is frequency of character c, ended strings (-1) come first
+		s64 count[RADIX + 2] = {0};
+		for (s64 i = start; i <= end; ++i) count[stringChar(data[i], d) + 2] += 1;
+
+		// all strings share d-th character, nothing to distribute (also keeps recursion shallow on long common prefixes)
+		s32 first = stringChar(data[start], d);
+		if (first != -1 && count[first + 2] == end - start + 1)
+		{
+			++d;
+			continue;
+		}
+
+		for (s64 r = 0; r <= RADIX; ++r) count[r + 1] += count[r];
+		for (s64 i = start; i <= end; ++i)
+		{
+			// character has to be read before the string is moved away
+			s32 c = stringChar(data[i], d);
+			aux[count[c + 1]++] = std::move(data[i]);
+		}
+		for (s64 i = start; i <= end; ++i) data[i] = std::move(aux[i - start]);
+
+		// ended strings [start, start + count[0]) are equal, bucket of character r is [count[r], count[r + 1])
+		for (s64 r = 0; r < RADIX; ++r)
+			if (count[r + 1] - count[r] > 1) MSDSort(data, aux, start + count[r], start + count[r + 1] - 1, d + 1);
+		return;
 	}
 }
 
+template <typename type>
+void MSDSort(ArraySpan<type> span, Array<type> & aux)
+{
+	if (span.size() <= 1) return;
+	if (aux.size() < span.size())
+	{
+		aux.reserve(span.size());
+		while (aux.size() < span.size()) aux.emplace_back();
+	}
+	MSDSort(span.data(), aux.data(), 0, span.size() - 1, 0);
+}
 
-template <typename type, typename compareType = compare_less<type>> // end included
-void quickSort(Array<type> & arr, s64 start, s64 end, Random64 & rng, compareType compare = compare_less<type>())
+template <typename type>
+void MSDSort(ArraySpan<type> span)
+{
+	Array<type> aux;
+	MSDSort(span, aux);
+}
+
+template <typename type>
+void MSDSort(Array<type> & arr, Array<type> & aux) { MSDSort(arr.span(), aux); }
+
+template <typename type>
+void MSDSort(Array<type> & arr) { MSDSort(arr.span()); }
+
+
+// end included, partition scan has no bounds check, so data[end + 1] has to exist and be not smaller than
+// every value within [start, end] - quickSort(data, size, ...) below arranges that for whole arrays
+template <typename type, typename compareType = compare_less<type>>
+void quickSort(type* data, s64 start, s64 end, Random64 & rng, compareType compare = compare_less<type>())
 {
 	// base case
 	if (end - start <= 20)
 	{
-		for (s64 i = start + 1; i <= end; ++i)
-		{
-			type el = std::move(arr[i]);
-			s64 j = i - 1;
-			while (j >= start && compare(el, arr[j]))
-			{
-				arr[j + 1] = std::move(arr[j]);
-				--j;
-			}
-			arr[j + 1] = std::move(el);
-		}
+		insertionSort(data, start, end, compare);
 		return;
 	}
 
 	// choose pivot
 	s64 pivot_index = start + rng.random() % (end - start + 1);
-	swap(arr[start], arr[pivot_index]);
-	type pivot = arr[start];
+	swap(data[start], data[pivot_index]);
+	type pivot = data[start];
 
 	s64 lt = start;
 	s64 gt = end + 1;
 	while (true)
 	{
-		while (compare(arr[++lt], pivot));
-		while (compare(pivot, arr[--gt]));
+		while (compare(data[++lt], pivot));
+		while (compare(pivot, data[--gt]));
 		if (lt >= gt) break;
-		swap(arr[lt], arr[gt]);
+		swap(data[lt], data[gt]);
 	}
-	swap(arr[start], arr[gt]);
+	swap(data[start], data[gt]);
 
-	quickSort(arr, start, gt - 1, rng, compare);
-	quickSort(arr, gt + 1, end, rng, compare);
+	quickSort(data, start, gt - 1, rng, compare);
+	quickSort(data, gt + 1, end, rng, compare);
 }
 
 template <typename type, typename compareType = compare_less<type>> // end included
-void quickSort(Array<type> & arr, compareType compare = compare_less<type>())
+void quickSort(Array<type> & arr, s64 start, s64 end, Random64 & rng, compareType compare = compare_less<type>())
+{
+	quickSort(arr.data(), start, end, rng, compare);
+}
+
+// sorts size values from data, single bubble pass moves the biggest value to the end, where it serves
+// as the sentinel of the partition scan, if the pass exchanges nothing values are already sorted
+template <typename type, typename compareType = compare_less<type>>
+void quickSort(type* data, s64 size, Random64 & rng, compareType compare = compare_less<type>())
 {
-	// does a single pass through array and if no exchanges are made returns true
 	bool exchanged = false;
-	const s64 size = arr.size();
 	for (s64 i = 0; i < size - 1; ++i)
 	{
-		if (compare(arr[i+1], arr[i]))
+		if (compare(data[i+1], data[i]))
 		{
-			swap(arr[i+1], arr[i]);
+			swap(data[i+1], data[i]);
 			exchanged = true;
 		}
 	}
 	if (!exchanged) return;
 
+	quickSort(data, 0, size - 2, rng, compare);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+void quickSort(ArraySpan<type> span, compareType compare = compare_less<type>())
+{
 	Random64 rng;
-	quickSort(arr, 0, arr.size() - 2, rng, compare);
+	quickSort(span.data(), span.size(), rng, compare);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+void quickSort(Array<type> & arr, compareType compare = compare_less<type>())
+{
+	quickSort(arr.span(), compare);
 }
 
 
 template <typename type, typename compareType = compare_less<type>> // end included
-void quickSort3Way(Array<type> & arr, s64 start, s64 end, Random64 & rng, compareType compare = compare_less<type>())
+void quickSort3Way(type* data, s64 start, s64 end, Random64 & rng, compareType compare = compare_less<type>())
 {
 	// base case
 	if (end - start <= 256)
 	{
-		for (s64 i = start + 1; i <= end; ++i)
-		{
-			type el = std::move(arr[i]);
-			s64 j = i - 1;
-			while (j >= start && compare(el, arr[j]))
-			{
-				arr[j + 1] = std::move(arr[j]);
-				--j;
-			}
-			arr[j + 1] = std::move(el);
-		}
+		insertionSort(data, start, end, compare);
 		return;
 	}
 
 	// choose pivot
 	s64 pivot_index = start + rng.random() % (end - start + 1);
-	swap(arr[start], arr[pivot_index]);
-	type pivot = arr[start];
+	swap(data[start], data[pivot_index]);
+	type pivot = data[start];
 
 
 	s64 lt = start;
@@ -253,49 +482,51 @@ void quickSort3Way(Array<type> & arr, s64 start, s64 end, Random64 & rng, compar
 	s64 pos = start + 1;
 	while (pos <= gt)
 	{
-		if (compare(arr[pos], pivot)) swap(arr[pos++], arr[lt++]);
-		else if (compare(pivot, arr[pos])) swap(arr[pos], arr[gt--]);
+		if (compare(data[pos], pivot)) swap(data[pos++], data[lt++]);
+		else if (compare(pivot, data[pos])) swap(data[pos], data[gt--]);
 		else ++pos;
 	}
-	quickSort3Way(arr, start, lt - 1, rng, compare);
-	quickSort3Way(arr, gt + 1, end, rng, compare);
+	quickSort3Way(data, start, lt - 1, rng, compare);
+	quickSort3Way(data, gt + 1, end, rng, compare);
 }
 
 template <typename type, typename compareType = compare_less<type>> // end included
-void quickSort3Way(Array<type> & arr, compareType compare = compare_less<type>())
+void quickSort3Way(Array<type> & arr, s64 start, s64 end, Random64 & rng, compareType compare = compare_less<type>())
+{
+	quickSort3Way(arr.data(), start, end, rng, compare);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+void quickSort3Way(ArraySpan<type> span, compareType compare = compare_less<type>())
 {
 	Random64 rng;
-	quickSort3Way(arr, 0, arr.size() - 1, rng, compare);
+	quickSort3Way(span.data(), 0, span.size() - 1, rng, compare);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+void quickSort3Way(Array<type> & arr, compareType compare = compare_less<type>())
+{
+	quickSort3Way(arr.span(), compare);
 }
 
 
 
 template <typename type, typename compareType = compare_less<type>> // end included
-void mergeSort(Array<type> & arr, type* aux, s64 start, s64 end, compareType compare = compare_less<type>())
+void mergeSort(type* data, type* aux, s64 start, s64 end, compareType compare = compare_less<type>())
 {
 	if (end - start <= 200) 
 	{
-		for (s64 i = start + 1; i <= end; ++i)
-		{
-			type el = std::move(arr[i]);
-			s64 j = i - 1;
-			while (j >= start && compare(el, arr[j]))
-			{
-				arr[j + 1] = std::move(arr[j]);
-				--j;
-			}
-			arr[j + 1] = std::move(el);
-		}
+		insertionSort(data, start, end, compare);
 		return;
 	}
 
 	s64 mid = start + (end - start) / 2;
-	mergeSort(arr, aux, start, mid, compare);
-	mergeSort(arr, aux, mid + 1, end, compare);
+	mergeSort(data, aux, start, mid, compare);
+	mergeSort(data, aux, mid + 1, end, compare);
 
 	// optimize for when both sides are already sorted to skip merge
 	// if whole array is sorted, skipping merge makes sorting linear
-	if (compare(arr[mid+1], arr[mid]))
+	if (compare(data[mid+1], data[mid]))
 	{
 		// merge step
 		s64 lhs = start;
@@ -303,72 +534,110 @@ void mergeSort(Array<type> & arr, type* aux, s64 start, s64 end, compareType com
 		s64 len = end - start + 1;
 		for (s64 i = 0; i < len; ++i)
 		{
-			if (lhs == mid + 1)						aux[i] = std::move(arr[rhs++]);
-			else if (rhs > end) 					aux[i] = std::move(arr[lhs++]);
-			else if (compare(arr[rhs], arr[lhs]))	aux[i] = std::move(arr[rhs++]);
-			else 									aux[i] = std::move(arr[lhs++]);
+			if (lhs == mid + 1)						aux[i] = std::move(data[rhs++]);
+			else if (rhs > end) 					aux[i] = std::move(data[lhs++]);
+			else if (compare(data[rhs], data[lhs]))	aux[i] = std::move(data[rhs++]);
+			else 									aux[i] = std::move(data[lhs++]);
 		}
 		// transfer merged sides from auxiliary array back to actual array
-		for (s64 i = 0; i < len; ++i) arr[start + i] = std::move(aux[i]);
+		for (s64 i = 0; i < len; ++i) data[start + i] = std::move(aux[i]);
 	}
 }
 
+template <typename type, typename compareType = compare_less<type>> // end included
+void mergeSort(Array<type> & arr, type* aux, s64 start, s64 end, compareType compare = compare_less<type>())
+{
+	mergeSort(arr.data(), aux, start, end, compare);
+}
+
 template <typename type, typename compareType = compare_less<type>>
-void mergeSort(Array<type> & arr, compareType compare = compare_less<type>())
+void mergeSort(ArraySpan<type> span, compareType compare = compare_less<type>())
 {
-	type* aux = new type[arr.size()];
-	mergeSort(arr, aux, 0, arr.size() - 1, compare);
+	type* aux = new type[span.size()];
+	mergeSort(span.data(), aux, 0, span.size() - 1, compare);
 	delete[] aux;
 }
 
 template <typename type, typename compareType = compare_less<type>>
-bool isSorted(const Array<type> & arr, compareType compare = compare_less<type>())
+void mergeSort(Array<type> & arr, compareType compare = compare_less<type>())
+{
+	mergeSort(arr.span(), compare);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+bool isSorted(ArrayView<type> view, compareType compare = compare_less<type>())
 {
-	s64 size = arr.size();
+	const type* data = view.data();
+	s64 size = view.size();
 	for (s64 i = 0; i < size - 1; ++i)
-		if (compare(arr[i+1], arr[i])) return false;
+		if (compare(data[i+1], data[i])) return false;
 	return true;
 }
 
 template <typename type, typename compareType = compare_less<type>>
-type select(const Array<type> & arr, s64 k, s64 start, s64 end, Random64 & rng, compareType compare = compare_less<type>())
+bool isSorted(const Array<type> & arr, compareType compare = compare_less<type>())
+{
+	return isSorted(arr.view(), compare);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+type select(type* data, s64 k, s64 start, s64 end, Random64 & rng, compareType compare = compare_less<type>())
 {
-	if (end - start == 0) return arr[start];
+	if (end - start == 0) return data[start];
 	// choose pivot
 	s64 pivot_index = start + rng.random() % (end - start + 1);
-	swap(arr[start], arr[pivot_index]);
-	type pivot = arr[start];
+	swap(data[start], data[pivot_index]);
+	type pivot = data[start];
 
 	s64 seperator = start + 1;
 	for (s64 pos = start + 1; pos <= end; ++pos)
 	{
-		if (compare(arr[pos], pivot)) swap(arr[pos], arr[seperator++]);
+		if (compare(data[pos], pivot)) swap(data[pos], data[seperator++]);
 	}
-	swap(arr[start], arr[seperator-1]);
+	swap(data[start], data[seperator-1]);
 
-	if (seperator-1 == k) return arr[k];
-	else if (seperator-1 < k) return select(arr, k, seperator, end, rng, compare);
-	else return select(arr, k, start, seperator - 2, rng, compare);
+	if (seperator-1 == k) return data[k];
+	else if (seperator-1 < k) return select(data, k, seperator, end, rng, compare);
+	else return select(data, k, start, seperator - 2, rng, compare);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+type select(const Array<type> & arr, s64 k, s64 start, s64 end, Random64 & rng, compareType compare = compare_less<type>())
+{
+	return select(&arr.at_unchecked(0), k, start, end, rng, compare);
+}
+
+template <typename type, typename compareType = compare_less<type>>
+type select(ArraySpan<type> span, s64 k, compareType compare = compare_less<type>())
+{
+	if (k < 0 || k >= span.size()) ERROR("select: k (%lld) out of range, size is %lld", k, span.size());
+	Random64 rng;
+	return select(span.data(), k, 0, span.size() - 1, rng, compare);
 }
 
 template <typename type, typename compareType = compare_less<type>>
 type select(const Array<type> & arr, s64 k, compareType compare = compare_less<type>())
 {
+	if (k < 0 || k >= arr.size()) ERROR("select: k (%lld) out of range, size is %lld", k, arr.size());
 	Random64 rng;
-	return select(arr, k, 0, arr.size() - 1, rng, compare);
+	return select(&arr.at_unchecked(0), k, 0, arr.size() - 1, rng, compare);
 }
 
 template <typename type>
-void shuffle(Array<type> & arr)
+void shuffle(ArraySpan<type> span)
 {
 	thread_local Random64 rng;
-	for (s64 pos = arr.size() - 1; pos > 0; --pos)
+	type* data = span.data();
+	for (s64 pos = span.size() - 1; pos > 0; --pos)
 	{
 		s64 rand_pos = rng.random() % (pos + 1);
-		swap(arr[pos], arr[rand_pos]);
+		swap(data[pos], data[rand_pos]);
 	}
 }
 
+template <typename type>
+void shuffle(Array<type> & arr) { shuffle(arr.span()); }
+
 
 
 #endif
\ No newline at end of file
@@ -7,6 +7,10 @@
 #include <cstdint> // int8_t ... types
 #include <cassert> // assert
 #include <chrono> // for getTimeElapsed function
+#if defined(_MSC_VER)
+#include <intrin.h> // _BitScanForward, _BitScanReverse
+#include <xmmintrin.h> // _mm_prefetch
+#endif
 
 
 typedef std::int8_t  s8;
@@ -154,6 +158,61 @@ inline static bool is_overflow_sub(s64 a, s64 b)
 	return a >= 0;
 }
 
+// hints cpu to start loading cache line with given address, doesn't wait for it
+inline static void prefetch(const void* address)
+{
+#if defined(_MSC_VER)
+	_mm_prefetch((const char*)address, _MM_HINT_T0);
+#else
+	__builtin_prefetch(address);
+#endif
+}
+
+// returns position of the lowest set bit, mask can't be 0
+inline static u32 count_trailing_zeros(u32 mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (u32)index;
+#else
+	return (u32)__builtin_ctz(mask);
+#endif
+}
+
+// returns number of zero bits above the highest set bit, mask can't be 0
+inline static u32 count_leading_zeros(u32 mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return 31 - (u32)index;
+#else
+	return (u32)__builtin_clz(mask);
+#endif
+}
+
+// returns smallest power of 2 not lower than value, value has to be at most 2^63
+inline static u64 round_up_pow2(u64 value)
+{
+	if (value <= 1) return 1;
+	value -= 1;
+	value |= value >> 1;
+	value |= value >> 2;
+	value |= value >> 4;
+	value |= value >> 8;
+	value |= value >> 16;
+	value |= value >> 32;
+	return value + 1;
+}
+
+// returns base 2 logarithm of a power of 2
+inline static u32 log2_pow2(u64 value)
+{
+	const u32 low = (u32)value;
+	return low != 0 ? count_trailing_zeros(low) : 32 + count_trailing_zeros((u32)(value >> 32));
+}
+
 
 /*
  * Code taken and adapted for my needs from